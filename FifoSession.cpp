@@ -12,6 +12,7 @@
 #include "Fifo.h"
 #include "Server.h"
 #include "ServerOptions.h"
+#include "Task.h"
 
 namespace fifo {
 
@@ -27,6 +28,7 @@ FifoSession::FifoSession(ServerWeakPtr server,
 	  primaryPubKeyAes,
 	  secondarySignatureWithKey,
 	  secondaryPubKeyAes) {
+  _task->setWeight(ServerOptions::_fifoSessionWeight);
   sendStatusToClient();
 }
 
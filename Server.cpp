@@ -8,7 +8,8 @@
 
 #include <boost/interprocess/sync/named_mutex.hpp>
 
-#include "Ad.h"
+#include "AdCatalog.h"
+#include "BatchJoinPolicy.h"
 #include "EchoPolicy.h"
 #include "FifoAcceptor.h"
 #include "FifoSession.h"
@@ -18,6 +19,7 @@
 #include "TaskController.h"
 #include "TcpAcceptor.h"
 #include "TcpSession.h"
+#include "Transaction.h"
 #include "Utility.h"
 
 Server::Server() :
@@ -38,7 +40,7 @@ Server::Server() :
 
 Server::~Server() {
   try {
-    Ad::clear();
+    AdCatalog::destroy();
     utility::removeAccess();
   }
   catch (const std::exception& e) {
@@ -49,13 +51,18 @@ Server::~Server() {
 void Server::setPolicy() {
   switch (ServerOptions::_policyEnum) {
   case POLICYENUM::NOSORTINPUT:
-    Ad::readAds(ServerOptions::_adsFileName);
+    AdCatalog::create(ServerOptions::_adsFileName);
     _policy = std::make_unique<NoSortInputPolicy>();
     break;
   case POLICYENUM::SORTINPUT:
-    Ad::readAds(ServerOptions::_adsFileName);
+    AdCatalog::create(ServerOptions::_adsFileName);
     _policy = std::make_unique<SortInputPolicy>();
     break;
+  case POLICYENUM::BATCHJOIN:
+    // the join replaces the result cache
+    AdCatalog::create(ServerOptions::_adsFileName);
+    _policy = std::make_unique<BatchJoinPolicy>();
+    break;
   case POLICYENUM::ECHOPOLICY:
     _policy = std::make_unique<EchoPolicy>();
     break;
@@ -65,7 +72,22 @@ void Server::setPolicy() {
   }
 }
 
+// Called on SIGHUP. The new catalog is built by the calling
+// thread while the workers keep serving the current one.
+
+void Server::reloadAds() {
+  if (ServerOptions::_policyEnum == POLICYENUM::ECHOPOLICY)
+    return;
+  try {
+    AdCatalog::create(ServerOptions::_adsFileName);
+  }
+  catch (const std::exception& e) {
+    LogError << e.what() << ", keeping current ads\n";
+  }
+}
+
 bool Server::start() {
+  Transaction::setSizePatterns(ServerOptions::_sizePatterns);
   setPolicy();
   if (!TaskController::create())
     return false;
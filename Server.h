@@ -37,6 +37,7 @@ public:
 			std::string_view secondarySignatureWithKey,
 			std::string_view secondaryPubKeyAes);
   const PolicyPtr& getPolicy() const { return _policy; }
+  void reloadAds();
   static void removeNamedMutex();
 private:
   void setPolicy();
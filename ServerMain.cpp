@@ -13,6 +13,7 @@
 #include "Metrics.h"
 #include "ServerOptions.h"
 #include "Server.h"
+#include "Transaction.h"
 #include "Utility.h"
 
 void signalHandler([[maybe_unused]] int signal) {}
@@ -28,23 +29,33 @@ int main() {
     signal(SIGPIPE, SIG_IGN);
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    signal(SIGHUP, signalHandler);
     sigset_t set;
     sigemptyset(&set);
     if (sigaddset(&set, SIGINT) == -1)
       LogError << strerror(errno) << '\n';
     if (sigaddset(&set, SIGTERM) == -1)
       LogError << strerror(errno) << '\n';
+    // 'kill -HUP <pid>' reloads ads without restart
+    if (sigaddset(&set, SIGHUP) == -1)
+      LogError << strerror(errno) << '\n';
     ServerOptions::parse("ServerOptions.json");
     CryptoBase::displayCryptoLibName();
     ServerPtr server = std::make_shared<Server>();
     if (!server->start())
       return 3;
-    int sig = 0;
-    if (sigwait(&set, &sig))
-      LogError << strerror(errno) << '\n';
+    while (true) {
+      int sig = 0;
+      if (sigwait(&set, &sig))
+	LogError << strerror(errno) << '\n';
+      if (sig != SIGHUP)
+	break;
+      server->reloadAds();
+    }
     Metrics::save();
     server->stop();
     Metrics::print();
+    Transaction::printStatistics();
     int closed = fcloseall();
     assert(closed == 0);
     return 0;
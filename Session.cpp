@@ -63,15 +63,28 @@ catch (const std::exception& e) {
   LogError << e.what() << '\n';
  }
 
+// queueing delay of the session to verify the fairness of the
+// scheduler under a mixed load
+
+Session::~Session() {
+  if (_numberTasks > 0)
+    Info << "session " << _clientId << " batches:" << _numberTasks
+	 << " queue delay average:" << (_totalQueueDelay / _numberTasks).count()
+	 << "us max:" << _maxQueueDelay.count() << "us\n";
+}
+
+// With frameSize the assembled reply is split into frames of
+// complete replies compressed and encrypted one at a time, all
+// frames but the last have STATUS::SUBTASK_DONE. Called again
+// while hasMoreFrames() is true. Only tcp sessions use frames.
+
 std::pair<HEADER, std::string_view>
-Session::buildReply(std::atomic<STATUS>& status) {
-  _responseData.clear();
-  const auto& response = _task->getResponse();
-  for (std::string_view entry : response)
-    _responseData += entry;
+Session::buildReply(std::atomic<STATUS>& status, std::size_t frameSize) {
+  _nextReply = _task->getResponse().assemble(_responseData, _nextReply, frameSize);
+  STATUS frameStatus = hasMoreFrames() ? STATUS::SUBTASK_DONE : status.load();
   HEADER header =
     { HEADERTYPE::SESSION, _responseData.size(), 0,
-      ServerOptions::_compressor, DIAGNOSTICS::NONE, status, 0, 0 };
+      ServerOptions::_compressor, DIAGNOSTICS::NONE, frameStatus, 0, 0 };
   static thread_local std::string encrypted;
   encrypted.clear();
   encrypted = Options::_doubleEncryption ?
@@ -85,10 +98,14 @@ Session::buildReply(std::atomic<STATUS>& status) {
 			  ServerOptions::_compressionLevel);
   std::string_view dataView = encrypted;
   header = { HEADERTYPE::SESSION, dataView.size(), 0,
-	     ServerOptions::_compressor, DIAGNOSTICS::NONE, status, 0, 0 };
+	     ServerOptions::_compressor, DIAGNOSTICS::NONE, frameStatus, 0, 0 };
   return { header, dataView };
 }
 
+bool Session::hasMoreFrames() const {
+  return _nextReply < _task->getResponse().size();
+}
+
 bool Session::processTask() {
   Options::_doubleEncryption ?
     doubleDecryptDecompress(_encryptors, _buffer, _header, _request) :
@@ -97,6 +114,12 @@ bool Session::processTask() {
   if (auto taskController = TaskController::getWeakPtr().lock()) {
     _task->update(_header, _request);
     taskController->processTask(_task);
+    _nextReply = 0;
+    ++_numberTasks;
+    _totalQueueDelay += _task->getQueueDelay();
+    _maxQueueDelay = std::max(_maxQueueDelay, _task->getQueueDelay());
+    // the old catalog is not held by idle sessions after a reload
+    _task->releaseCatalog();
     return true;
   }
   return false;
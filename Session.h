@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 
 #include <boost/core/noncopyable.hpp>
@@ -23,6 +24,12 @@ protected:
   std::string _request;
   TaskPtr _task;
   std::string _responseData;
+  // index of the next reply of the task to send
+  std::size_t _nextReply = 0;
+  // time from queueing to processing of the batches
+  std::size_t _numberTasks = 0;
+  std::chrono::microseconds _totalQueueDelay{};
+  std::chrono::microseconds _maxQueueDelay{};
   std::string _buffer;
   ServerWeakPtr _server;
 
@@ -42,9 +49,10 @@ protected:
 	  std::string_view primaryPubKeyAes,
 	  std::string_view secondarySignatureWithKey,
 	  std::string_view secondaryPubKeyAes);
-  virtual ~Session() = default;
+  virtual ~Session();
   std::pair<HEADER, std::string_view>
-  buildReply(std::atomic<STATUS>& status);
+  buildReply(std::atomic<STATUS>& status, std::size_t frameSize = 0);
+  bool hasMoreFrames() const;
   bool processTask();
 
   template <typename L>
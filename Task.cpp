@@ -5,7 +5,10 @@
 #include "Task.h"
 
 #include <algorithm>
+#include <numeric>
 
+#include "AdCatalog.h"
+#include "Logger.h"
 #include "Server.h"
 #include "ServerOptions.h"
 #include "Transaction.h"
@@ -13,57 +16,346 @@
 
 Task::Task (ServerWeakPtr server) : _server(server) {}
 
+namespace {
+
+constexpr std::size_t MIN_CHUNK_SIZE = 1 << 16;
+
+// limits the work claimed at once by a thread
+constexpr std::size_t MAX_BATCH_GROUPS = 256;
+
+// a chunk is this share of the remaining units per thread
+constexpr std::size_t GUIDED_DIVISOR = 2;
+
+// Threads ingesting chunks of large batches in addition to
+// the session threads, at most NumberWorkThreads - 1 for all
+// sessions together. A session gets what is left, without
+// any it ingests its batch alone.
+
+std::atomic<std::size_t> numberIngestThreads = 0;
+
+class IngestThreads {
+  std::size_t _number = 0;
+ public:
+  explicit IngestThreads(std::size_t wanted) {
+    std::size_t limit = std::max(ServerOptions::_numberWorkThreads, 1) - 1;
+    std::size_t current = numberIngestThreads.load();
+    do {
+      _number = std::min(wanted, limit - std::min(limit, current));
+      if (_number == 0)
+	return;
+    } while (!numberIngestThreads.compare_exchange_weak(current, current + _number));
+  }
+  ~IngestThreads() { numberIngestThreads -= _number; }
+  std::size_t size() const { return _number; }
+};
+
+} // end of anonymous namespace
+
 void Task::update(const HEADER& header, std::string_view request) {
-  _promise = std::promise<void>();
+  _completion.reset();
   _diagnostics = isDiagnosticsEnabled(header);
-  _size = utility::splitReuseVector(request, _requests);
-  if (ServerOptions::_policyEnum == POLICYENUM::SORTINPUT) {
-    _sortedIndices.resize(_size);
-    for (std::size_t i = 0; i < _size; ++i)
-      _sortedIndices[i] = i;
+  _catalog = AdCatalog::get();
+  ingest(request);
+  _batches.clear();
+  switch (ServerOptions::_policyEnum) {
+  case POLICYENUM::SORTINPUT:
+    groupRequests();
+    break;
+  case POLICYENUM::BATCHJOIN:
+    groupRequests();
+    if (!_diagnostics)
+      createBatches();
+    break;
+  default:
+    break;
   }
-  _response.resize(_size);
+  _response.reset(ServerOptions::_numberWorkThreads, _size);
+  _workerStats.assign(ServerOptions::_numberWorkThreads, WorkerStats());
+  _numberChunks = 0;
+  _numberSteals = 0;
+  _nextSlice = 0;
 }
 
-void Task::sortIndices() {
-  std::sort(_sortedIndices.begin(), _sortedIndices.end(), [this] (int idx1, int idx2) {
-	      return _requests[idx1]._sizeKey < _requests[idx2]._sizeKey;
-	    });
+// The format of the first requests is the format of the batch.
+// If they differ every request probes all field names, a
+// request in another format falls back to it individually.
+
+void Task::detectFormat(std::string_view batch) {
+  static constexpr std::size_t FORMAT_SAMPLE = 4;
+  _format = REQUESTFORMAT::ANY;
+  for (std::size_t i = 0; i < FORMAT_SAMPLE; ++i) {
+    std::size_t end = batch.find('\n');
+    if (end == std::string_view::npos)
+      break;
+    REQUESTFORMAT format = RequestScanner::scan(batch.substr(0, end))._format;
+    batch.remove_prefix(end + 1);
+    if (i == 0)
+      _format = format;
+    else if (format != _format) {
+      _format = REQUESTFORMAT::ANY;
+      break;
+    }
+  }
 }
 
-bool Task::preprocessNext() {
-  std::size_t index = _index.fetch_add(1);
-  if (index < _size) {
-    Request& request = _requests[index];
-    request._sizeKey = Transaction::createSizeKey(request._input);
+// Lines are split and scanned in the same pass, a large batch
+// in chunks ending with a complete line in parallel. This runs
+// in the session thread, the workers may be busy with the
+// previous batch. Requests keep the order of the lines.
+
+void Task::ingest(std::string_view batch) {
+  detectFormat(batch);
+  std::size_t maxChunks = std::min<std::size_t>(batch.size() / MIN_CHUNK_SIZE, ServerOptions::_numberWorkThreads);
+  IngestThreads ingestThreads(std::max<std::size_t>(maxChunks, 1) - 1);
+  utility::splitChunks(batch, ingestThreads.size() + 1, MIN_CHUNK_SIZE, _chunks);
+  if (_chunkRequests.size() < _chunks.size())
+    _chunkRequests.resize(_chunks.size());
+  std::vector<std::size_t> chunkSizes(_chunks.size());
+  utility::runParallel(_chunks.size(), [this, &chunkSizes] (std::size_t chunk) {
+    chunkSizes[chunk] = ingestChunk(_chunks[chunk], chunk == 0 ? _requests : _chunkRequests[chunk]);
+  });
+  _size = _chunks.empty() ? 0 : chunkSizes[0];
+  for (std::size_t chunk = 1; chunk < _chunks.size(); ++chunk) {
+    const auto& requests = _chunkRequests[chunk];
+    if (_requests.size() < _size + chunkSizes[chunk])
+      _requests.resize(_size + chunkSizes[chunk]);
+    std::copy(requests.cbegin(), requests.cbegin() + chunkSizes[chunk], _requests.begin() + _size);
+    _size += chunkSizes[chunk];
   }
-  return _index < _size;
-}
-
-bool Task::processNext() {
-  std::size_t index = _index.fetch_add(1);
-  if (index < _size) {
-    if (auto server = _server.lock()) {
-      auto& policy = server->getPolicy();
-      assert(policy);
-      switch (ServerOptions::_policyEnum) {
-      case POLICYENUM::SORTINPUT: {
-	std::size_t orgIndex = _sortedIndices[index];
-	Request& request = _requests[orgIndex];
-	_response[orgIndex] = (*policy) (request, _diagnostics);
-	break;
-      }
-      default: {
-	Request& request = _requests[index];
-	_response[index] = (*policy) (request, _diagnostics);
-	break;
-      }
+}
+
+// Like utility::splitReuseVector, a line without '\n' at the
+// end of the batch is ignored. The vector keeps its capacity.
+
+std::size_t Task::ingestChunk(std::string_view chunk, std::vector<Request>& requests) const {
+  std::size_t size = 0;
+  std::size_t start = 0;
+  while (start < chunk.size()) {
+    std::size_t next = chunk.find('\n', start);
+    if (next == std::string_view::npos)
+      break;
+    if (size >= requests.size())
+      requests.emplace_back();
+    Request& request = requests[size++];
+    request = chunk.substr(start, next - start);
+    Transaction::scanRequest(request, _format);
+    request._sizeId = _catalog ? _catalog->getSizeId(request._sizeKey) : UNKNOWN_SIZE;
+    start = next + 1;
+  }
+  return size;
+}
+
+// Requests are bucket sorted by size id, unknown sizes last,
+// and sorted by the hash of the keywords within the size.
+// Adjacent requests with the same size and keywords form a
+// group. With diagnostics every request is a group, the reply
+// shows the request.
+
+void Task::groupRequests() {
+  std::size_t numberSizes = _catalog ? _catalog->getNumberSizes() : 0;
+  auto getBucket = [numberSizes] (SizeId sizeId) {
+    return std::min<std::size_t>(sizeId, numberSizes);
+  };
+  _sizeOffsets.assign(numberSizes + 2, 0);
+  for (std::size_t i = 0; i < _size; ++i)
+    ++_sizeOffsets[getBucket(_requests[i]._sizeId) + 1];
+  std::partial_sum(_sizeOffsets.cbegin(), _sizeOffsets.cend(), _sizeOffsets.begin());
+  _groupKeys.resize(_size);
+  // a request without an id or a size is a group of its own,
+  // its reply can not be copied, it sorts first in the bucket
+  for (std::size_t i = 0; i < _size; ++i) {
+    std::size_t bucket = getBucket(_requests[i]._sizeId);
+    bool known = bucket < numberSizes && !_diagnostics && Transaction::hasIdAndSize(_requests[i]);
+    _groupKeys[_sizeOffsets[bucket]++] = { known ? catalogimage::hashString(_requests[i]._keywords) : 0, i };
+  }
+  // offsets were advanced to the end of every bucket
+  _groups.clear();
+  _duplicates = 0;
+  _sortedIndices.resize(_size);
+  std::size_t begin = 0;
+  for (std::size_t bucket = 0; bucket <= numberSizes; ++bucket) {
+    std::size_t end = _sizeOffsets[bucket];
+    bool known = bucket < numberSizes && !_diagnostics;
+    if (known)
+      std::sort(_groupKeys.begin() + begin, _groupKeys.begin() + end);
+    bool leaderGroups = false;
+    for (std::size_t pos = begin; pos < end; ++pos) {
+      const GroupKey& key = _groupKeys[pos];
+      _sortedIndices[pos] = key._index;
+      bool groups = known && Transaction::hasIdAndSize(_requests[key._index]);
+      if (groups && leaderGroups && key._hash == _groupKeys[_groups.back()]._hash &&
+	  _requests[key._index]._keywords == _requests[_sortedIndices[_groups.back()]]._keywords)
+	++_duplicates;
+      else {
+	_groups.push_back(pos);
+	leaderGroups = groups;
       }
     }
+    begin = end;
+  }
+  _groups.push_back(_size);
+}
+
+// Consecutive groups of one size, at most MAX_BATCH_GROUPS,
+// form a batch.
+
+void Task::createBatches() {
+  for (std::size_t group = 0; group < getNumberGroups(); ++group) {
+    SizeId sizeId = _requests[_sortedIndices[_groups[group]]]._sizeId;
+    if (_batches.empty() || group - _batches.back() == MAX_BATCH_GROUPS ||
+	sizeId != _requests[_sortedIndices[_groups[_batches.back()]]]._sizeId)
+      _batches.push_back(group);
+  }
+  _batches.push_back(getNumberGroups());
+}
+
+void Task::processGroup(std::size_t group, Policy& policy, unsigned worker) {
+  std::size_t first = _sortedIndices[_groups[group]];
+  _response.store(worker, first, policy(_requests[first], _catalog, isDiagnosed(first)));
+  copyReplies(group, worker);
+}
+
+// the first requests of the groups are answered by the policy
+
+void Task::processBatch(std::size_t batch, Policy& policy, unsigned worker) {
+  thread_local std::vector<std::size_t> indices;
+  indices.clear();
+  for (std::size_t group = _batches[batch]; group < _batches[batch + 1]; ++group)
+    indices.push_back(_sortedIndices[_groups[group]]);
+  policy.processBatch(_requests, indices, _catalog, _response, worker);
+  for (std::size_t group = _batches[batch]; group < _batches[batch + 1]; ++group)
+    copyReplies(group, worker);
+}
+
+void Task::copyReplies(std::size_t group, unsigned worker) {
+  std::size_t first = _sortedIndices[_groups[group]];
+  for (std::size_t pos = _groups[group] + 1; pos < _groups[group + 1]; ++pos) {
+    std::size_t orgIndex = _sortedIndices[pos];
+    _response.store(worker, orgIndex, Transaction::copyReply(_requests[orgIndex], _requests[first], _response[first]));
+  }
+}
+
+std::size_t Task::getNumberUnits() const {
+  switch (ServerOptions::_policyEnum) {
+  case POLICYENUM::SORTINPUT:
+    return getNumberGroups();
+  case POLICYENUM::BATCHJOIN:
+    return _diagnostics ? getNumberGroups() : getNumberBatches();
+  default:
+    return _size;
+  }
+}
+
+// With diagnostics every DiagnosticsSampling-th request in
+// the batch is diagnosed, at most DiagnosticsMaxRequests of
+// them, the others get the usual reply. The replies are kept
+// until the last frame is sent, the limit bounds the memory.
+
+bool Task::isDiagnosed(std::size_t index) const {
+  if (!_diagnostics || index % ServerOptions::_diagnosticsSampling != 0)
+    return false;
+  return ServerOptions::_diagnosticsMaxRequests == 0 ||
+    index / ServerOptions::_diagnosticsSampling < ServerOptions::_diagnosticsMaxRequests;
+}
+
+// SORTINPUT processes groups of requests, BATCHJOIN batches
+// of groups, other policies single requests.
+
+void Task::processUnit(std::size_t index, Policy& policy, unsigned worker) {
+  switch (ServerOptions::_policyEnum) {
+  case POLICYENUM::SORTINPUT:
+    processGroup(index, policy, worker);
+    break;
+  case POLICYENUM::BATCHJOIN:
+    if (_diagnostics)
+      processGroup(index, policy, worker);
+    else
+      processBatch(index, policy, worker);
+    break;
+  default:
+    _response.store(worker, index, policy(_requests[index], _catalog, isDiagnosed(index)));
+    break;
+  }
+}
+
+void Task::processUnits(std::size_t begin, std::size_t end, unsigned worker) {
+  if (auto server = _server.lock()) {
+    auto& policy = server->getPolicy();
+    assert(policy);
+    for (std::size_t index = begin; index < end; ++index)
+      processUnit(index, *policy, worker);
+  }
+  _numberChunks.fetch_add(1, std::memory_order_relaxed);
+  _workerStats[worker]._units += end - begin;
+}
+
+// Guided claiming, a thread takes a share of the remaining
+// units. Chunks are large at the start and shrink to a single
+// unit at the tail, where they balance the threads.
+
+bool Task::processNext(unsigned worker) {
+  std::size_t size = getNumberUnits();
+  std::size_t begin = _index.load(std::memory_order_relaxed);
+  std::size_t end = 0;
+  do {
+    if (begin >= size)
+      return false;
+    std::size_t chunk = (size - begin) / (GUIDED_DIVISOR * ServerOptions::_numberWorkThreads);
+    end = begin + std::max<std::size_t>(chunk, 1);
+  } while (!_index.compare_exchange_weak(begin, end));
+  processUnits(begin, end, worker);
+  return end < size;
+}
+
+std::pair<std::size_t, std::size_t> Task::takeSlice(std::size_t sliceSize) {
+  std::size_t size = getNumberUnits();
+  if (_nextSlice == 0) {
+    setStarted();
+    _remaining = size;
+    if (size == 0) {
+      finish();
+      return {};
+    }
+  }
+  // a BATCHJOIN unit is a batch of up to MAX_BATCH_GROUPS groups
+  std::size_t units = sliceSize * _weight;
+  if (ServerOptions::_policyEnum == POLICYENUM::BATCHJOIN && !_diagnostics)
+    units = std::max<std::size_t>(units / MAX_BATCH_GROUPS, 1);
+  std::size_t begin = _nextSlice;
+  _nextSlice = sliceSize == 0 ? size : std::min(size, begin + units);
+  return { begin, _nextSlice };
+}
+
+void Task::setStarted() {
+  _queueDelay = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _queued);
+}
+
+// Ranges of a task are processed by any threads in any order,
+// the thread processing the last unit finishes the task.
+
+void Task::processRange(std::size_t begin, std::size_t end, unsigned worker) {
+  processUnits(begin, end, worker);
+  if (_remaining.fetch_sub(end - begin) == end - begin)
+    finish();
+}
+
+double Task::getImbalance() const {
+  std::size_t total = 0;
+  std::size_t max = 0;
+  for (const WorkerStats& stats : _workerStats) {
+    total += stats._units;
+    max = std::max(max, stats._units);
   }
-  return _index < _size;
+  return total == 0 ? 1. : static_cast<double>(max) * _workerStats.size() / total;
 }
 
 void Task::finish() {
-  _promise.set_value();
+  if (ServerOptions::_policyEnum == POLICYENUM::SORTINPUT ||
+      ServerOptions::_policyEnum == POLICYENUM::BATCHJOIN)
+    Debug << "requests:" << _size << " groups:" << getNumberGroups()
+	  << " duplicates:" << _duplicates << " batches:" << getNumberBatches() << '\n';
+  Debug << "units:" << getNumberUnits() << " chunks:" << _numberChunks
+	<< " steals:" << _numberSteals << " imbalance:" << getImbalance()
+	<< " weight:" << _weight << " queue delay:" << _queueDelay.count() << "us\n";
+  _completion.signal();
 }
@@ -5,23 +5,32 @@
 #pragma once
 
 #include <atomic>
-#include <future>
+#include <chrono>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <tuple>
 
 #include <boost/core/noncopyable.hpp>
 
+#include "Completion.h"
 #include "IOUtility.h"
 #include "Header.h"
+#include "RequestScanner.h"
+#include "Response.h"
 
 using SIZETUPLE = std::tuple<unsigned, unsigned>;
 
-using Response = std::vector<std::string>;
+using SizeId = std::uint32_t;
 
 using PreprocessRequest = SIZETUPLE (*)(std::string_view);
 
 using ServerWeakPtr = std::weak_ptr<class Server>;
 
+class Policy;
+
+using AdCatalogPtr = std::shared_ptr<const class AdCatalog>;
+
 struct Request {
 
   Request() = default;
@@ -33,38 +42,134 @@ struct Request {
   }
 
   SIZETUPLE _sizeKey;
+  // value of "kw=" or "keywords=" in _input
+  std::string_view _keywords;
+  // index of the size in the catalog of the task
+  SizeId _sizeId = std::numeric_limits<SizeId>::max();
   std::string_view _input;
 };
 
 class Task : private boost::noncopyable {
   std::vector<Request> _requests;
   std::size_t _size = 0;
+  // chunks of a large batch ingested in parallel,
+  // requests of chunk 0 are in _requests
+  std::vector<std::string_view> _chunks;
+  std::vector<std::vector<Request>> _chunkRequests;
   std::vector<std::size_t> _sortedIndices;
+  // SORTINPUT: requests with the same size and keywords form
+  // a group processed once, [_groups[i], _groups[i + 1]) in
+  // _sortedIndices, the first request of the group is answered
+  // by the policy. The keys are reused to sort by keywords.
+  struct GroupKey {
+    std::uint64_t _hash;
+    std::size_t _index;
+    auto operator <=> (const GroupKey&) const = default;
+  };
+  std::vector<GroupKey> _groupKeys;
+  std::vector<std::size_t> _sizeOffsets;
+  std::vector<std::size_t> _groups;
+  // BATCHJOIN: groups of one size joined with the ads at
+  // once, [_batches[i], _batches[i + 1]) in _groups
+  std::vector<std::size_t> _batches;
+  std::size_t _duplicates = 0;
   Response _response;
-  std::promise<void> _promise;
+  Completion _completion;
   std::atomic<std::size_t> _index = 0;
+  // work stealing, units not processed yet
+  std::atomic<std::size_t> _remaining = 0;
+  // Statistics of the batch. Units processed by every thread,
+  // a cache line each, the threads do not share the counters.
+  struct alignas(64) WorkerStats {
+    std::size_t _units = 0;
+  };
+  std::vector<WorkerStats> _workerStats;
+  std::atomic<std::size_t> _numberChunks = 0;
+  std::atomic<std::size_t> _numberSteals = 0;
+  // time slicing, the first unit of the next slice, guarded by
+  // the queue of the controller
+  std::size_t _nextSlice = 0;
+  // slices of a task are this times larger
+  std::size_t _weight = 1;
+  std::chrono::steady_clock::time_point _queued;
+  std::chrono::microseconds _queueDelay{};
   bool _diagnostics;
   ServerWeakPtr _server;
+  // snapshot of the ads used by the whole batch
+  AdCatalogPtr _catalog;
+  // field names shared by the requests of the batch
+  REQUESTFORMAT _format = REQUESTFORMAT::ANY;
+  void detectFormat(std::string_view batch);
+  void ingest(std::string_view batch);
+  std::size_t ingestChunk(std::string_view chunk, std::vector<Request>& requests) const;
+  void groupRequests();
+  void createBatches();
+  void processGroup(std::size_t group, Policy& policy, unsigned worker);
+  void processBatch(std::size_t batch, Policy& policy, unsigned worker);
+  void copyReplies(std::size_t group, unsigned worker);
+  void processUnit(std::size_t index, Policy& policy, unsigned worker);
+  void processUnits(std::size_t begin, std::size_t end, unsigned worker);
+  bool isDiagnosed(std::size_t index) const;
 
  public:
   explicit Task (ServerWeakPtr server = ServerWeakPtr());
 
   ~Task() = default;
 
-  const Response& getResponse() const { return _response; }
+  Response& getResponse() { return _response; }
 
   void update(const HEADER& header, std::string_view request);
 
-  void sortIndices();
+  std::size_t getNumberGroups() const { return _groups.empty() ? 0 : _groups.size() - 1; }
+
+  std::size_t getNumberBatches() const { return _batches.empty() ? 0 : _batches.size() - 1; }
+
+  // replies copied from another request of the batch
+  std::size_t getNumberDuplicates() const { return _duplicates; }
+
+  std::size_t getNumberRequests() const { return _size; }
 
   void resetIndex() { _index = 0; }
 
-  std::promise<void>& getPromise() { return _promise; }
+  Completion& getCompletion() { return _completion; }
+
+  // units of work claimed by the threads
+  std::size_t getNumberUnits() const;
+
+  // worker is the index of the calling thread in the pool
+  bool processNext(unsigned worker);
+
+  // Work stealing, the next units [begin, end) of the task,
+  // sliceSize times the weight units, all of them if sliceSize
+  // is 0. The first slice starts the task, a task without units
+  // is finished and the slice is empty.
+  std::pair<std::size_t, std::size_t> takeSlice(std::size_t sliceSize);
 
-  bool preprocessNext();
+  void processRange(std::size_t begin, std::size_t end, unsigned worker);
 
-  bool processNext();
+  // a range of the task was taken by another thread
+  void countSteal() { _numberSteals.fetch_add(1, std::memory_order_relaxed); }
+
+  // chunks or ranges claimed by the threads
+  std::size_t getNumberChunks() const { return _numberChunks; }
+
+  std::size_t getNumberSteals() const { return _numberSteals; }
+
+  // set by the session, slices are this times larger
+  void setWeight(std::size_t weight) { _weight = weight; }
+
+  void setQueued() { _queued = std::chrono::steady_clock::now(); }
+
+  void setStarted();
+
+  // from queued to the start of processing
+  std::chrono::microseconds getQueueDelay() const { return _queueDelay; }
+
+  // units of the busiest thread to the average, 1 is even
+  double getImbalance() const;
 
   void finish();
 
+  void releaseCatalog() { _catalog.reset(); }
+
 };
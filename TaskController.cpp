@@ -9,14 +9,21 @@
 #include "Task.h"
 
 TaskControllerPtr TaskController::_instance;
-TaskController::Phase TaskController::_phase = PREPROCESSTASK;
 std::mutex TaskController::_mutex;
 
+namespace {
+
+// ranges larger than this are split in halves
+constexpr std::size_t MIN_RANGE_SIZE = 16;
+
+} // end of anonymous namespace
+
 TaskController::TaskController() :
   _barrier(ServerOptions::_numberWorkThreads, onTaskCompletion),
-  _threadPool(ServerOptions::_numberWorkThreads) {
+  _threadPool(ServerOptions::_numberWorkThreads),
+  _workQueues(ServerOptions::_numberWorkThreads) {
   // start with empty task
-  _task = std::make_shared<Task>();
+  _tasks.push_back(std::make_shared<Task>());
 }
 
 TaskControllerWeakPtr TaskController::getWeakPtr() {
@@ -32,25 +39,17 @@ void TaskController::onTaskCompletion() noexcept {
 }
 
 void TaskController::onCompletion() {
-  switch (_phase) {
-  case PREPROCESSTASK:
-    _task->sortIndices();
-    _task->resetIndex();
-    _phase = PROCESSTASK;
-    break;
-  case PROCESSTASK:
-    _task->finish();
-    // Blocks until the new task is available.
-    setNextTask();
-    _task->resetIndex();
-    _phase = PREPROCESSTASK;
-    break;
-  }
+  for (const TaskPtr& task : _tasks)
+    task->finish();
+  // Blocks until a new task is available.
+  setNextTasks();
+  for (const TaskPtr& task : _tasks)
+    task->resetIndex();
 }
 
 bool TaskController::start() {
   for (int i = 0; i < ServerOptions::_numberWorkThreads; ++i) {
-    auto worker = std::make_shared<Worker>(_instance);
+    auto worker = std::make_shared<Worker>(_instance, i);
     _threadPool.push(worker);
   }
   return true;
@@ -58,23 +57,44 @@ bool TaskController::start() {
 
 void TaskController::push(TaskPtr task) {
   std::lock_guard lock(_queueMutex);
+  task->setQueued();
   _queue.push(task);
   _queueCondition.notify_one();
 }
 
 void TaskController::processTask(TaskPtr task) {
-  auto future = task->getPromise().get_future();
+  Completion& completion = task->getCompletion();
   push(task);
-  future.get();
+  completion.wait(ServerOptions::_completionSpinCount);
 }
 
-void TaskController::setNextTask() {
+// Small batches of different sessions are processed in one
+// phase, the threads pass the barrier once for all of them.
+// Queued batches are added while the phase has fewer than
+// CoalesceRequests requests, waiting up to CoalesceWindow
+// for more. Every batch keeps its own response and is
+// finished separately.
+
+void TaskController::setNextTasks() {
   std::unique_lock lock(_queueMutex);
   _queueCondition.wait(lock, [this] { return !_queue.empty() || _stopped; });
   if (_stopped)
     return;
-  _task = _queue.front();
-  _queue.pop();
+  _tasks.clear();
+  std::size_t numberRequests = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(ServerOptions::_coalesceWindow);
+  do {
+    TaskPtr task = std::move(_queue.front());
+    _queue.pop();
+    task->setStarted();
+    numberRequests += task->getNumberRequests();
+    _tasks.push_back(std::move(task));
+    if (numberRequests >= ServerOptions::_coalesceRequests)
+      break;
+    if (_queue.empty() && ServerOptions::_coalesceWindow > 0)
+      _queueCondition.wait_until(lock, deadline, [this] { return !_queue.empty() || _stopped; });
+  } while (!_queue.empty() && !_stopped &&
+	   numberRequests + _queue.front()->getNumberRequests() <= ServerOptions::_coalesceRequests);
 }
 
 bool TaskController::create() {
@@ -89,7 +109,7 @@ void  TaskController::stop() {
   {
     std::lock_guard lock(_queueMutex);
     _stopped.store(true);
-    _queueCondition.notify_one();
+    _queueCondition.notify_all();
   }
   _threadPool.stop();
 }
@@ -101,27 +121,135 @@ void TaskController::destroy() {
   std::shared_ptr<TaskController>().swap(_instance);
 }
 
-TaskController::Worker::Worker(TaskControllerWeakPtr taskController) :
+TaskController::Worker::Worker(TaskControllerWeakPtr taskController, unsigned index) :
   Runnable(ServerOptions::_numberWorkThreads),
-  _taskController(taskController) {}
-
-// Process the current task (batch of requests) by all threads. Arrive
-// at the sync point when the task is done and wait for the next one.
+  _taskController(taskController),
+  _index(index) {}
 
 void TaskController::Worker::run() noexcept {
   if (auto taskController = _taskController.lock()) {
-    auto& stopped = taskController->_stopped;
-    auto& task = taskController->_task;
-    auto& barrier = taskController->_barrier;
-    while (!stopped) {
-      if (_phase == PROCESSTASK) {
-	while (task->processNext());
-	barrier.arrive_and_wait();
-      }
-      else if (_phase == PREPROCESSTASK) {
-	while (task->preprocessNext());
-	barrier.arrive_and_wait();
-      }
+    if (ServerOptions::_workStealing)
+      runStealing(*taskController);
+    else
+      runBarrier(*taskController);
+  }
+}
+
+// Process the current tasks (batches of requests) by all threads. Arrive
+// at the sync point when the tasks are done and wait for the next ones.
+// Requests are ingested by the session before the task is queued.
+
+void TaskController::Worker::runBarrier(TaskController& taskController) {
+  auto& stopped = taskController._stopped;
+  auto& tasks = taskController._tasks;
+  auto& barrier = taskController._barrier;
+  while (!stopped) {
+    for (const TaskPtr& task : tasks)
+      while (task->processNext(_index));
+    barrier.arrive_and_wait();
+  }
+}
+
+// Tasks of different sessions are processed at the same time.
+// A thread splits its range, a whole task or a slice of it, in
+// halves until it is small, the halves are left for itself or
+// for idle threads to steal.
+
+void TaskController::Worker::runStealing(TaskController& taskController) {
+  Range range;
+  while (taskController.getRange(_index, range)) {
+    while (range._end - range._begin > MIN_RANGE_SIZE) {
+      std::size_t middle = range._begin + (range._end - range._begin) / 2;
+      taskController.pushRange(_index, { range._task, middle, range._end });
+      range._end = middle;
     }
+    range._task->processRange(range._begin, range._end, _index);
+    range._task.reset();
+  }
+}
+
+// Without slicing a queued task is started first, then the
+// ranges of the thread are processed. With slicing the ranges
+// of the thread are finished before the next slice is taken,
+// the queue lock is taken once per slice, not once per range.
+// Ranges of other threads are stolen last. Returns false if
+// the controller is stopped.
+
+bool TaskController::getRange(unsigned worker, Range& range) {
+  while (!_stopped) {
+    bool found = ServerOptions::_sliceSize == 0 ?
+      takeSlice(range) || popRange(worker, range) :
+      popRange(worker, range) || takeSlice(range);
+    if (found || stealRange(worker, range))
+      return true;
+    std::unique_lock lock(_queueMutex);
+    ++_numberIdle;
+    _queueCondition.wait(lock, [this] {
+      return !_queue.empty() || _numberRanges > 0 || _stopped;
+    });
+    --_numberIdle;
+  }
+  return false;
+}
+
+// Queued tasks take turns, a task with more units after this
+// slice goes to the back of the queue. A small batch waits for
+// at most one slice of every task ahead of it.
+
+bool TaskController::takeSlice(Range& range) {
+  std::lock_guard lock(_queueMutex);
+  while (!_queue.empty()) {
+    TaskPtr task = std::move(_queue.front());
+    _queue.pop();
+    auto [begin, end] = task->takeSlice(ServerOptions::_sliceSize);
+    if (begin == end)
+      continue;
+    if (end < task->getNumberUnits()) {
+      _queue.push(task);
+      if (_numberIdle > 0)
+	_queueCondition.notify_one();
+    }
+    range = { std::move(task), begin, end };
+    return true;
+  }
+  return false;
+}
+
+bool TaskController::popRange(unsigned worker, Range& range) {
+  WorkQueue& workQueue = _workQueues[worker];
+  std::lock_guard lock(workQueue._mutex);
+  if (workQueue._ranges.empty())
+    return false;
+  range = std::move(workQueue._ranges.back());
+  workQueue._ranges.pop_back();
+  --_numberRanges;
+  return true;
+}
+
+bool TaskController::stealRange(unsigned worker, Range& range) {
+  for (std::size_t i = 1; i < _workQueues.size(); ++i) {
+    WorkQueue& workQueue = _workQueues[(worker + i) % _workQueues.size()];
+    std::lock_guard lock(workQueue._mutex);
+    if (workQueue._ranges.empty())
+      continue;
+    range = std::move(workQueue._ranges.front());
+    workQueue._ranges.pop_front();
+    --_numberRanges;
+    range._task->countSteal();
+    return true;
+  }
+  return false;
+}
+
+void TaskController::pushRange(unsigned worker, Range&& range) {
+  {
+    WorkQueue& workQueue = _workQueues[worker];
+    std::lock_guard lock(workQueue._mutex);
+    workQueue._ranges.push_back(std::move(range));
+    ++_numberRanges;
+  }
+  if (_numberIdle > 0) {
+    std::lock_guard lock(_queueMutex);
+    _queueCondition.notify_one();
   }
 }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <barrier>
+#include <deque>
 #include <queue>
 
 #include <boost/core/noncopyable.hpp>
@@ -17,31 +18,56 @@ using TaskControllerWeakPtr = std::weak_ptr<class TaskController>;
 
 class TaskController : public std::enable_shared_from_this<TaskController>,
 		       private boost::noncopyable {
-  enum Phase { PREPROCESSTASK, PROCESSTASK };
   class Worker : public Runnable {
     bool start() override { return true; }
     void stop() override {}
     void run() noexcept override;
+    void runBarrier(TaskController& taskController);
+    void runStealing(TaskController& taskController);
     TaskControllerWeakPtr _taskController;
+    // index of the thread, selects its reply arena
+    const unsigned _index;
   public:
-    explicit Worker(TaskControllerWeakPtr taskController);
+    Worker(TaskControllerWeakPtr taskController, unsigned index);
   };
   using CompletionFunction = void (*) () noexcept;
+  // units [_begin, _end) of the task
+  struct Range {
+    TaskPtr _task;
+    std::size_t _begin = 0;
+    std::size_t _end = 0;
+  };
+  // The owner pushes and pops ranges at the back,
+  // other threads steal at the front.
+  struct WorkQueue {
+    std::mutex _mutex;
+    std::deque<Range> _ranges;
+  };
   bool start();
   void stop();
   void push(TaskPtr task);
-  void setNextTask();
+  void setNextTasks();
   static void onTaskCompletion() noexcept;
   void onCompletion();
+  bool getRange(unsigned worker, Range& range);
+  bool takeSlice(Range& range);
+  bool popRange(unsigned worker, Range& range);
+  bool stealRange(unsigned worker, Range& range);
+  void pushRange(unsigned worker, Range&& range);
   std::atomic<bool> _stopped = false;
   std::barrier<CompletionFunction> _barrier;
   ThreadPoolBase _threadPool;
   std::mutex _queueMutex;
   std::condition_variable _queueCondition;
   std::queue<TaskPtr> _queue;
-  TaskPtr _task;
+  // batches processed in the current barrier phase
+  std::vector<TaskPtr> _tasks;
+  std::vector<WorkQueue> _workQueues;
+  // ranges in the work queues
+  std::atomic<std::size_t> _numberRanges = 0;
+  // threads waiting for a task or a range
+  std::atomic<unsigned> _numberIdle = 0;
   static TaskControllerPtr _instance;
-  static Phase _phase;
   static std::mutex _mutex;
  public:
   TaskController();
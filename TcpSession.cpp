@@ -11,6 +11,7 @@
 #include "Connection.h"
 #include "Server.h"
 #include "ServerOptions.h"
+#include "Task.h"
 #include "Tcp.h"
 
 namespace tcp {
@@ -32,6 +33,7 @@ TcpSession::TcpSession(ServerWeakPtr server,
   _ioContext(_connection->_ioContext),
   _socket(std::move(_connection->_socket)),
   _timeoutTimer(_ioContext) {
+  _task->setWeight(ServerOptions::_tcpSessionWeight);
   sendStatusToClient();
 }
 
@@ -82,7 +84,8 @@ void TcpSession::stop() {
 }
 
 bool TcpSession::sendReply() {
-  auto [header, payload] = buildReply(_status);
+  std::size_t frameSize = isDiagnosticsEnabled(_header) ? ServerOptions::_diagnosticsFrameSize : 0;
+  auto [header, payload] = buildReply(_status, frameSize);
   if (payload.empty())
     return false;
   asyncWait();
@@ -158,6 +161,10 @@ void TcpSession::write(const HEADER& header, std::string_view payload) {
 	_status = STATUS::TCP_TIMEOUT;
 	return;
       }
+      if (hasMoreFrames()) {
+	boost::asio::post(_ioContext, [this] { sendReply(); });
+	return;
+      }
       _request.clear();
       boost::asio::post(_ioContext, [this] { readRequest(); });
     });
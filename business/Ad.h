@@ -4,17 +4,20 @@
 
 #pragma once
 
-#include <map>
-#include <memory>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
 #include <vector>
 
-struct AdBid;
+#include "AdBid.h"
 
 using SIZETUPLE = std::tuple<unsigned, unsigned>;
-using AdPtr = std::shared_ptr<class Ad>;
-using SizeMap = std::map<SIZETUPLE, std::vector<AdPtr>>;
 
-class Ad : public std::enable_shared_from_this<Ad> {
+// Parsed ad input line. Exists only while the catalog
+// is built, string views are backed by the ads text.
+// Lines are parsed by several threads.
+
+class Ad {
   enum INPUTPARTS {
     ADPART,
     BIDPART,
@@ -28,25 +31,22 @@ class Ad : public std::enable_shared_from_this<Ad> {
     ADNUMBERFIELDS
   };
  public:
+  struct Bid {
+    std::string_view _keyword;
+    std::int64_t _money = 0;
+    // assigned by the catalog builder
+    KeywordId _keywordId = 0;
+  };
   explicit Ad(std::string_view line);
+  Ad(Ad&&) = default;
   ~Ad() = default;
-  void print(std::string& output) const;
-  std::string_view getId() const { return _id; }
-  const std::vector<AdBid>& getBids() const { return _bids; }
-  std::vector<AdBid>& getBids() { return _bids; }
-  static void readAds(std::string_view filename);
-  static void clear();
-  static const std::vector<AdPtr>& getAdsBySize(const SIZETUPLE& key);
-  static constexpr double _scaler = 100.;
- private:
-  bool parseAttributes();
   bool parseArray();
-  void printBids(std::string& output) const;
+  std::string_view _input;
   std::string_view _id;
   SIZETUPLE _sizeKey;
-  std::vector<AdBid> _bids;
-  long _defaultBid = 0;
-  const std::string _input;
+  std::int64_t _defaultBid = 0;
+  std::vector<Bid> _bids;
+ private:
+  bool parseAttributes();
   std::string_view _array;
-  static SizeMap _mapBySize;
 };
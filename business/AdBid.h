@@ -4,16 +4,25 @@
 
 #pragma once
 
-#include <memory>
+#include <cstdint>
+#include <limits>
 
-using AdWeakPtr = std::weak_ptr<class Ad>;
+using KeywordId = std::uint32_t;
+using AdIndex = std::uint32_t;
+using BidIndex = std::uint32_t;
+using SizeId = std::uint32_t;
 
-class Ad;
+constexpr KeywordId UNKNOWN_KEYWORD = std::numeric_limits<KeywordId>::max();
+
+constexpr SizeId UNKNOWN_SIZE = std::numeric_limits<SizeId>::max();
+
+// Entry of the flat bid table of the catalog.
+// The ad is referenced by its index in the catalog.
+// Fixed size fields, the table is a part of the
+// binary catalog image.
 
 struct AdBid {
-  AdBid(const AdWeakPtr& ad, std::string_view keyword, long money);
-  ~AdBid() = default;
-  AdWeakPtr _ad;
-  std::string_view _keyword;
-  long _money = 0;
+  KeywordId _keywordId = 0;
+  AdIndex _adIndex = 0;
+  std::int64_t _money = 0;
 };
@@ -0,0 +1,209 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include "AdCatalog.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <boost/interprocess/file_mapping.hpp>
+
+#include "CatalogBuilder.h"
+#include "IOUtility.h"
+#include "Logger.h"
+#include "Utility.h"
+
+using namespace catalogimage;
+
+using ioutility::operator<<;
+
+const SizeBucket AdCatalog::_emptyBucket;
+
+std::atomic<AdCatalogPtr> AdCatalog::_instance;
+
+namespace {
+
+bool isImage(std::string_view filename) {
+  std::ifstream stream(filename.data(), std::ios::binary);
+  if (!stream)
+    throw std::runtime_error(std::string("failed to open ").append(filename));
+  std::array<char, MAGIC.size()> magic{};
+  stream.read(magic.data(), magic.size());
+  return stream.gcount() == static_cast<std::streamsize>(magic.size()) && magic == MAGIC;
+}
+
+template <typename T>
+std::span<const T> getSection(std::string_view image, const Header& header, SECTION section) {
+  const Section& descriptor = header._sections[section];
+  if (descriptor._offset % ALIGNMENT != 0 ||
+      descriptor._offset > image.size() ||
+      descriptor._size > image.size() - descriptor._offset ||
+      descriptor._size % sizeof(T) != 0)
+    throw std::runtime_error("corrupted catalog image");
+  return { reinterpret_cast<const T*>(image.data() + descriptor._offset),
+	   descriptor._size / sizeof(T) };
+}
+
+} // end of anonymous namespace
+
+AdCatalog::AdCatalog(std::string_view filename) : _generation(utility::getUniqueId()) {
+  if (isImage(filename)) {
+    boost::interprocess::file_mapping mapping(filename.data(), boost::interprocess::read_only);
+    _region = boost::interprocess::mapped_region(mapping, boost::interprocess::read_only);
+    attach({ static_cast<const char*>(_region.get_address()), _region.get_size() });
+  }
+  else {
+    std::string text;
+    utility::readFile(filename, text);
+    CatalogBuilder(text).build(_buffer);
+    attach({ _buffer.data(), _buffer.size() });
+  }
+}
+
+// Validates the header and the section bounds,
+// the image is trusted otherwise.
+
+void AdCatalog::attach(std::string_view image) {
+  Header header;
+  if (image.size() < sizeof(Header))
+    throw std::runtime_error("catalog image is too short");
+  std::memcpy(&header, image.data(), sizeof(Header));
+  if (header._magic != MAGIC)
+    throw std::runtime_error("not a catalog image");
+  if (header._version != VERSION || header._numberSections != NUMBERSECTIONS)
+    throw std::runtime_error("unsupported catalog image version");
+  if (reinterpret_cast<std::uintptr_t>(image.data()) % ALIGNMENT != 0)
+    throw std::runtime_error("misaligned catalog image");
+  std::span<const char> pool = getSection<char>(image, header, POOL);
+  _pool = { pool.data(), pool.size() };
+  std::span<const StringRef> keywords = getSection<StringRef>(image, header, KEYWORDS);
+  std::span<const PerfectHash> perfectHash = getSection<PerfectHash>(image, header, PERFECTHASH);
+  std::span<const std::uint16_t> pilots = getSection<std::uint16_t>(image, header, PILOTS);
+  std::span<const std::uint32_t> remap = getSection<std::uint32_t>(image, header, REMAP);
+  std::span<const KeywordId> table = getSection<KeywordId>(image, header, KEYWORDTABLE);
+  if (perfectHash.size() != 1 ||
+      perfectHash[0]._numberKeys != keywords.size() ||
+      table.size() != keywords.size() ||
+      pilots.size() != perfectHash[0]._numberBuckets ||
+      remap.size() + keywords.size() != (keywords.empty() ? 0 : perfectHash[0]._tableSize))
+    throw std::runtime_error("corrupted catalog image");
+  _dictionary = KeywordDictionary(_pool, keywords, perfectHash[0], pilots, remap, table);
+  _ids = getSection<StringRef>(image, header, ADIDS);
+  _sizes = getSection<AdSize>(image, header, ADSIZES);
+  _defaultBids = getSection<std::int64_t>(image, header, DEFAULTBIDS);
+  _inputs = getSection<StringRef>(image, header, INPUTS);
+  _bidOffsets = getSection<BidIndex>(image, header, BIDOFFSETS);
+  _bids = getSection<AdBid>(image, header, BIDS);
+  _postings = getSection<BidIndex>(image, header, POSTINGS);
+  _buckets = getSection<SizeBucket>(image, header, SIZES);
+  _sizeTable = getSection<SizeId>(image, header, SIZETABLE);
+  _index = getSection<IndexEntry>(image, header, INDEX);
+  _bloom = getSection<std::uint64_t>(image, header, BLOOM);
+  if (_sizes.size() != _ids.size() || _defaultBids.size() != _ids.size() ||
+      _inputs.size() != _ids.size() || _bidOffsets.size() != _ids.size() + 1 ||
+      _bidOffsets.back() != _bids.size() ||
+      (!_buckets.empty() && _sizeTable.size() <= _buckets.size()) || (!_sizeTable.empty() && !std::has_single_bit(_sizeTable.size())))
+    throw std::runtime_error("corrupted catalog image");
+}
+
+SizeId AdCatalog::getSizeId(const SIZETUPLE& key) const {
+  if (_sizeTable.empty())
+    return UNKNOWN_SIZE;
+  AdSize size{ std::get<0>(key), std::get<1>(key) };
+  std::size_t mask = _sizeTable.size() - 1;
+  for (std::size_t slot = hashSize(size) & mask; ; slot = (slot + 1) & mask) {
+    SizeId sizeId = _sizeTable[slot];
+    if (sizeId == UNKNOWN_SIZE || _buckets[sizeId]._size == size)
+      return sizeId;
+  }
+}
+
+const IndexEntry* AdCatalog::findEntry(const SizeBucket& bucket, KeywordId keywordId) const {
+  if (bucket._indexCapacity == 0)
+    return nullptr;
+  std::span<const IndexEntry> table = _index.subspan(bucket._indexBegin, bucket._indexCapacity);
+  std::size_t mask = table.size() - 1;
+  for (std::size_t slot = hashInteger(keywordId) & mask; ; slot = (slot + 1) & mask) {
+    const IndexEntry& entry = table[slot];
+    if (entry._keywordId == keywordId)
+      return &entry;
+    if (entry._keywordId == UNKNOWN_KEYWORD)
+      return nullptr;
+  }
+}
+
+std::span<const BidIndex> AdCatalog::getPostings(const SizeBucket& bucket, KeywordId keywordId) const {
+  const IndexEntry* entry = findEntry(bucket, keywordId);
+  if (!entry)
+    return {};
+  return _postings.subspan(entry->_begin, entry->_end - entry->_begin);
+}
+
+const AdBid* AdCatalog::getBestBid(const SizeBucket& bucket, KeywordId keywordId) const {
+  const IndexEntry* entry = findEntry(bucket, keywordId);
+  if (!entry)
+    return nullptr;
+  return &_bids[entry->_best];
+}
+
+// Builds the new catalog in the calling thread, the current
+// one is served until the swap. Throws if the file can not
+// be loaded, the current catalog is kept in this case.
+
+void AdCatalog::create(std::string_view filename) {
+  AdCatalogPtr catalog = std::make_shared<const AdCatalog>(filename);
+  Info << "loaded " << catalog->size() << " ads from " << filename
+       << (catalog->isMapped() ? " (mapped)" : "") << '\n';
+  _instance.store(std::move(catalog));
+}
+
+void AdCatalog::destroy() {
+  _instance.store(AdCatalogPtr());
+}
+
+// The image is written to a temporary file and renamed,
+// a running server never maps a partially written file.
+
+void AdCatalog::compile(std::string_view textFile, std::string_view imageFile) {
+  std::string text;
+  utility::readFile(textFile, text);
+  std::vector<char> image;
+  CatalogBuilder(text).build(image);
+  std::string tmpFile(imageFile);
+  tmpFile.append(".tmp");
+  {
+    std::ofstream stream(tmpFile, std::ios::binary | std::ios::trunc);
+    if (!stream)
+      throw std::runtime_error("failed to open " + tmpFile);
+    stream.write(image.data(), image.size());
+    if (!stream)
+      throw std::runtime_error("failed to write " + tmpFile);
+  }
+  std::filesystem::rename(tmpFile, imageFile);
+}
+
+// Replacement for ostream operators to reduce number of
+// memory allocations.
+
+void AdCatalog::print(AdIndex index, std::string& output) const {
+  static constexpr auto AD{ "Ad" };
+  static constexpr auto SIZE{ " size=" };
+  static constexpr auto DEFAULTBID{ " defaultBid=" };
+  static constexpr auto DELIMITER{ "\n " };
+  const AdSize& size = _sizes[index];
+  output << AD << getId(index) << SIZE << SIZETUPLE{ size._width, size._height }
+	 << DEFAULTBID << _defaultBids[index] << DELIMITER << getString(_inputs[index]) << '\n';
+  printBids(index, output);
+}
+
+void AdCatalog::printBids(AdIndex index, std::string& output) const {
+  static constexpr auto SPACES{ "  " };
+  for (BidIndex i = _bidOffsets[index]; i < _bidOffsets[index + 1]; ++i) {
+    const AdBid& adBid = _bids[i];
+    output << SPACES << getKeyword(adBid._keywordId) << ' ' << adBid._money << '\n';
+  }
+}
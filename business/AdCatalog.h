@@ -0,0 +1,98 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "CatalogImage.h"
+#include "KeywordDictionary.h"
+
+using SIZETUPLE = std::tuple<unsigned, unsigned>;
+using AdCatalogPtr = std::shared_ptr<const class AdCatalog>;
+using SizeBucket = catalogimage::SizeBucket;
+
+// Immutable structure of arrays, a view of the catalog image.
+// The image is mapped read-only from the file compiled by
+// adsCompilerX or built in memory if the file is text.
+// Everything is referenced by index, the bids of the ad
+// are [_bidOffsets[ad], _bidOffsets[ad + 1]) in the bid
+// table, sorted by keyword. Bid indices grow with the ad
+// index, sorting bid indices restores the order of ads.
+// Ads of one size are contiguous in the input order, the
+// size index maps a keyword to the bids of this size.
+// The current catalog is published as a shared snapshot.
+// A reload builds a new catalog and swaps the pointer,
+// every task keeps the snapshot it started with and the
+// old catalog is destroyed with the last reference.
+// std::atomic<std::shared_ptr> is not lock free in
+// libstdc++, get() is called once per batch in Task::update,
+// requests use the snapshot of the task without touching it.
+
+class AdCatalog : private boost::noncopyable {
+ public:
+  explicit AdCatalog(std::string_view filename);
+  ~AdCatalog() = default;
+  SizeId getSizeId(const SIZETUPLE& key) const;
+  const SizeBucket& getBucket(SizeId sizeId) const {
+    return sizeId < _buckets.size() ? _buckets[sizeId] : _emptyBucket;
+  }
+  const SizeBucket& getBucket(const SIZETUPLE& key) const { return getBucket(getSizeId(key)); }
+  // size ids are [0, getNumberSizes())
+  std::size_t getNumberSizes() const { return _buckets.size(); }
+  std::span<const BidIndex> getPostings(const SizeBucket& bucket, KeywordId keywordId) const;
+  const AdBid* getBestBid(const SizeBucket& bucket, KeywordId keywordId) const;
+  // false if the keyword is certainly not in the bucket,
+  // hash is catalogimage::hashString(keyword)
+  bool mayContain(const SizeBucket& bucket, std::uint64_t hash) const {
+    return catalogimage::bloomMayContain(_bloom.subspan(bucket._bloomBegin, bucket._bloomWords),
+					 catalogimage::hashInteger(hash));
+  }
+  const KeywordDictionary& getDictionary() const { return _dictionary; }
+  const AdBid& getBid(BidIndex index) const { return _bids[index]; }
+  std::string_view getId(AdIndex index) const { return getString(_ids[index]); }
+  std::string_view getKeyword(KeywordId keywordId) const {
+    return _dictionary.getKeyword(keywordId);
+  }
+  std::size_t size() const { return _ids.size(); }
+  std::size_t getGeneration() const { return _generation; }
+  bool isMapped() const { return _region.get_address() != nullptr; }
+  void print(AdIndex index, std::string& output) const;
+  static void create(std::string_view filename);
+  static void destroy();
+  static AdCatalogPtr get() { return _instance.load(); }
+  static void compile(std::string_view textFile, std::string_view imageFile);
+ private:
+  void attach(std::string_view image);
+  const catalogimage::IndexEntry* findEntry(const SizeBucket& bucket, KeywordId keywordId) const;
+  std::string_view getString(const catalogimage::StringRef& ref) const {
+    return { _pool.data() + ref._offset, ref._size };
+  }
+  void printBids(AdIndex index, std::string& output) const;
+  const std::size_t _generation;
+  std::vector<char> _buffer;
+  boost::interprocess::mapped_region _region;
+  std::string_view _pool;
+  KeywordDictionary _dictionary;
+  std::span<const catalogimage::StringRef> _ids;
+  std::span<const catalogimage::AdSize> _sizes;
+  std::span<const std::int64_t> _defaultBids;
+  std::span<const catalogimage::StringRef> _inputs;
+  std::span<const BidIndex> _bidOffsets;
+  std::span<const AdBid> _bids;
+  std::span<const BidIndex> _postings;
+  std::span<const SizeBucket> _buckets;
+  std::span<const SizeId> _sizeTable;
+  std::span<const catalogimage::IndexEntry> _index;
+  std::span<const std::uint64_t> _bloom;
+  static const SizeBucket _emptyBucket;
+  static std::atomic<AdCatalogPtr> _instance;
+};
@@ -0,0 +1,355 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include "CatalogBuilder.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <span>
+#include <thread>
+
+#include "Logger.h"
+#include "Utility.h"
+
+using namespace catalogimage;
+
+namespace {
+
+constexpr std::size_t MIN_CHUNK_SIZE = 1 << 16;
+
+// Bids of the ad are sorted by keyword, the keyword id order
+// is the same. The keywords of the chunk are sorted and unique.
+// An ad is added only if the whole line is parsed.
+
+void parseChunk(std::string_view chunk, std::vector<Ad>& ads, std::vector<std::string_view>& keywords) {
+  std::vector<std::string_view> lines;
+  utility::split(chunk, lines);
+  ads.reserve(lines.size());
+  for (std::string_view line : lines) {
+    try {
+      Ad ad(line);
+      ad.parseArray();
+      std::stable_sort(ad._bids.begin(), ad._bids.end(), [] (const Ad::Bid& bid1, const Ad::Bid& bid2) {
+	return bid1._keyword < bid2._keyword; });
+      for (const Ad::Bid& bid : ad._bids)
+	keywords.push_back(bid._keyword);
+      ads.push_back(std::move(ad));
+    }
+    catch (const std::runtime_error& error) {
+      Expected << error.what() << '\n';
+    }
+  }
+  // the first occurrence of the keyword is kept, the image
+  // does not depend on the number of chunks
+  std::sort(keywords.begin(), keywords.end(), [] (std::string_view keyword1, std::string_view keyword2) {
+    int result = keyword1.compare(keyword2);
+    return result < 0 || (result == 0 && keyword1.data() < keyword2.data()); });
+  keywords.erase(std::unique(keywords.begin(), keywords.end()), keywords.end());
+}
+
+} // end of anonymous namespace
+
+// Chunks are parsed on all cores and concatenated in the
+// input order, the result does not depend on the number
+// of threads.
+
+CatalogBuilder::CatalogBuilder(std::string_view text) : _text(text) {
+  if (_text.size() > std::numeric_limits<std::uint32_t>::max())
+    throw std::runtime_error("ads file is too large");
+  std::vector<std::string_view> chunks;
+  utility::splitChunks(_text, std::thread::hardware_concurrency(), MIN_CHUNK_SIZE, chunks);
+  std::vector<std::vector<Ad>> chunkAds(chunks.size());
+  std::vector<std::vector<std::string_view>> chunkKeywords(chunks.size());
+  utility::runParallel(chunks.size(), [&] (std::size_t chunk) {
+    parseChunk(chunks[chunk], chunkAds[chunk], chunkKeywords[chunk]);
+  });
+  collectKeywords(chunkKeywords);
+  utility::runParallel(chunks.size(), [&] (std::size_t chunk) {
+    for (Ad& ad : chunkAds[chunk])
+      for (Ad::Bid& bid : ad._bids)
+	bid._keywordId = std::lower_bound(_keywordStrings.cbegin(), _keywordStrings.cend(), bid._keyword) -
+	  _keywordStrings.cbegin();
+  });
+  std::size_t numberAds = 0;
+  for (const auto& ads : chunkAds)
+    numberAds += ads.size();
+  _ads.reserve(numberAds);
+  for (auto& ads : chunkAds)
+    std::move(ads.begin(), ads.end(), std::back_inserter(_ads));
+  layout();
+  buildIndex();
+  buildSizeTable();
+  buildPerfectHash();
+}
+
+StringRef CatalogBuilder::makeRef(std::string_view str) const {
+  return { static_cast<std::uint32_t>(str.data() - _text.data()),
+	   static_cast<std::uint32_t>(str.size()) };
+}
+
+// Keyword ids are ranks of the sorted unique keywords.
+// Sorted chunk keywords are merged pairwise in parallel,
+// std::set_union keeps the keyword of the earlier chunk.
+
+void CatalogBuilder::collectKeywords(std::vector<std::vector<std::string_view>>& chunkKeywords) {
+  while (chunkKeywords.size() > 1) {
+    std::vector<std::vector<std::string_view>> merged((chunkKeywords.size() + 1) / 2);
+    utility::runParallel(merged.size(), [&] (std::size_t i) {
+      if (2 * i + 1 == chunkKeywords.size()) {
+	merged[i] = std::move(chunkKeywords[2 * i]);
+	return;
+      }
+      const auto& keywords1 = chunkKeywords[2 * i];
+      const auto& keywords2 = chunkKeywords[2 * i + 1];
+      merged[i].reserve(keywords1.size() + keywords2.size());
+      std::set_union(keywords1.cbegin(), keywords1.cend(), keywords2.cbegin(), keywords2.cend(),
+		     std::back_inserter(merged[i]));
+    });
+    chunkKeywords = std::move(merged);
+  }
+  if (!chunkKeywords.empty())
+    _keywordStrings = std::move(chunkKeywords[0]);
+  _keywords.reserve(_keywordStrings.size());
+  for (std::string_view keyword : _keywordStrings)
+    _keywords.push_back(makeRef(keyword));
+}
+
+// Ads of one size are contiguous in the input order,
+// sizes are in the SIZETUPLE order.
+
+void CatalogBuilder::layout() {
+  std::map<AdSize, std::vector<unsigned>> bySize;
+  for (unsigned i = 0; i < _ads.size(); ++i) {
+    const auto& [width, height] = _ads[i]._sizeKey;
+    bySize[{ width, height }].push_back(i);
+  }
+  _bidOffsets.push_back(0);
+  for (const auto& [size, adIndices] : bySize) {
+    SizeBucket& bucket = _sizes.emplace_back();
+    bucket._size = size;
+    bucket._begin = _adIds.size();
+    for (unsigned i : adIndices) {
+      const Ad& ad = _ads[i];
+      AdIndex adIndex = _adIds.size();
+      _adIds.push_back(makeRef(ad._id));
+      _adSizes.push_back(size);
+      _defaultBids.push_back(ad._defaultBid);
+      _inputs.push_back(makeRef(ad._input));
+      for (const Ad::Bid& bid : ad._bids)
+	_bids.push_back({ bid._keywordId, adIndex, bid._money });
+      _bidOffsets.push_back(_bids.size());
+    }
+    bucket._end = _adIds.size();
+  }
+}
+
+// Postings of a keyword are in the ad order. A keyword repeated
+// in the same ad is indexed once, like in std::set_intersection
+// with a unique request keyword.
+
+void CatalogBuilder::buildIndex() {
+  for (SizeBucket& bucket : _sizes) {
+    std::vector<BidIndex> bidIndices;
+    for (AdIndex adIndex = bucket._begin; adIndex < bucket._end; ++adIndex) {
+      for (BidIndex i = _bidOffsets[adIndex]; i < _bidOffsets[adIndex + 1]; ++i) {
+	if (i > _bidOffsets[adIndex] && _bids[i]._keywordId == _bids[i - 1]._keywordId)
+	  continue;
+	bidIndices.push_back(i);
+      }
+    }
+    std::stable_sort(bidIndices.begin(), bidIndices.end(), [this] (BidIndex index1, BidIndex index2) {
+      return _bids[index1]._keywordId < _bids[index2]._keywordId; });
+    std::vector<IndexEntry> entries;
+    for (std::size_t i = 0; i < bidIndices.size(); ) {
+      IndexEntry& entry = entries.emplace_back();
+      entry._keywordId = _bids[bidIndices[i]]._keywordId;
+      entry._begin = _postings.size();
+      entry._best = bidIndices[i];
+      for (; i < bidIndices.size() && _bids[bidIndices[i]]._keywordId == entry._keywordId; ++i) {
+	_postings.push_back(bidIndices[i]);
+	if (_bids[bidIndices[i]]._money > _bids[entry._best]._money)
+	  entry._best = bidIndices[i];
+      }
+      entry._end = _postings.size();
+    }
+    bucket._indexBegin = _index.size();
+    bucket._indexCapacity = entries.empty() ? 0 : std::bit_ceil(2 * entries.size());
+    _index.resize(_index.size() + bucket._indexCapacity);
+    std::span<IndexEntry> table(_index.data() + bucket._indexBegin, bucket._indexCapacity);
+    std::size_t mask = table.size() - 1;
+    for (const IndexEntry& entry : entries) {
+      std::size_t slot = hashInteger(entry._keywordId) & mask;
+      while (table[slot]._keywordId != UNKNOWN_KEYWORD)
+	slot = (slot + 1) & mask;
+      table[slot] = entry;
+    }
+    buildBloom(bucket, entries);
+  }
+}
+
+void CatalogBuilder::buildBloom(SizeBucket& bucket, const std::vector<IndexEntry>& entries) {
+  bucket._bloomBegin = _bloom.size();
+  if (entries.empty())
+    return;
+  std::size_t bits = entries.size() * BLOOM_BITS_PER_KEYWORD;
+  bucket._bloomWords = std::bit_ceil((bits + 63) / 64);
+  _bloom.resize(_bloom.size() + bucket._bloomWords);
+  std::span<std::uint64_t> filter(_bloom.data() + bucket._bloomBegin, bucket._bloomWords);
+  for (const IndexEntry& entry : entries)
+    bloomInsert(filter, hashInteger(hashString(_keywordStrings[entry._keywordId])));
+}
+
+void CatalogBuilder::buildSizeTable() {
+  if (_sizes.empty())
+    return;
+  _sizeTable.assign(std::bit_ceil(2 * _sizes.size()), UNKNOWN_SIZE);
+  std::size_t mask = _sizeTable.size() - 1;
+  for (SizeId id = 0; id < _sizes.size(); ++id) {
+    std::size_t slot = hashSize(_sizes[id]._size) & mask;
+    while (_sizeTable[slot] != UNKNOWN_SIZE)
+      slot = (slot + 1) & mask;
+    _sizeTable[slot] = id;
+  }
+}
+
+// Seeds are tried until every bucket finds a pilot, a failure
+// is unlikely with the table 2% larger than the keyword set.
+
+void CatalogBuilder::buildPerfectHash() {
+  static constexpr unsigned MAX_ATTEMPTS = 100;
+  std::uint32_t numberKeys = _keywordStrings.size();
+  if (numberKeys == 0)
+    return;
+  _perfectHash._numberKeys = numberKeys;
+  _perfectHash._tableSize = numberKeys + numberKeys / 50 + 1;
+  _perfectHash._numberBuckets = (numberKeys + PERFECTHASH_BUCKET_SIZE - 1) / PERFECTHASH_BUCKET_SIZE;
+  std::vector<std::uint64_t> hashes;
+  hashes.reserve(numberKeys);
+  for (std::string_view keyword : _keywordStrings)
+    hashes.push_back(hashString(keyword));
+  for (unsigned attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+    _perfectHash._seed = hashInteger(attempt + 1);
+    if (placeKeywords(hashes))
+      return;
+  }
+  throw std::runtime_error("failed to build the keyword perfect hash");
+}
+
+// Buckets are placed largest first, while the table is empty.
+
+bool CatalogBuilder::placeKeywords(const std::vector<std::uint64_t>& hashes) {
+  const std::uint32_t numberKeys = _perfectHash._numberKeys;
+  const std::uint32_t numberBuckets = _perfectHash._numberBuckets;
+  std::vector<std::uint64_t> keys(numberKeys);
+  std::vector<std::uint32_t> bucketOffsets(numberBuckets + 1, 0);
+  for (KeywordId id = 0; id < numberKeys; ++id) {
+    keys[id] = perfectHashKey(_perfectHash, hashes[id]);
+    ++bucketOffsets[perfectHashBucket(_perfectHash, keys[id]) + 1];
+  }
+  std::partial_sum(bucketOffsets.begin(), bucketOffsets.end(), bucketOffsets.begin());
+  std::vector<KeywordId> bucketKeys(numberKeys);
+  std::vector<std::uint32_t> cursors(bucketOffsets.begin(), bucketOffsets.end() - 1);
+  for (KeywordId id = 0; id < numberKeys; ++id)
+    bucketKeys[cursors[perfectHashBucket(_perfectHash, keys[id])]++] = id;
+  std::vector<std::uint32_t> order(numberBuckets);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&bucketOffsets] (std::uint32_t bucket1, std::uint32_t bucket2) {
+    return bucketOffsets[bucket1 + 1] - bucketOffsets[bucket1] > bucketOffsets[bucket2 + 1] - bucketOffsets[bucket2]; });
+  std::vector<bool> taken(_perfectHash._tableSize, false);
+  std::vector<std::uint32_t> slots(numberKeys);
+  std::vector<std::uint32_t> positions;
+  _pilots.assign(numberBuckets, 0);
+  for (std::uint32_t bucket : order) {
+    std::uint32_t begin = bucketOffsets[bucket];
+    std::uint32_t end = bucketOffsets[bucket + 1];
+    if (begin == end)
+      break;
+    bool placed = false;
+    for (std::uint32_t pilot = 0; pilot <= std::numeric_limits<std::uint16_t>::max() && !placed; ++pilot) {
+      positions.clear();
+      placed = true;
+      for (std::uint32_t i = begin; i < end; ++i) {
+	std::uint32_t position = perfectHashPosition(_perfectHash, keys[bucketKeys[i]], pilot);
+	if (taken[position]) {
+	  placed = false;
+	  break;
+	}
+	taken[position] = true;
+	positions.push_back(position);
+      }
+      if (placed) {
+	_pilots[bucket] = pilot;
+	for (std::uint32_t i = begin; i < end; ++i)
+	  slots[bucketKeys[i]] = positions[i - begin];
+      }
+      else {
+	for (std::uint32_t position : positions)
+	  taken[position] = false;
+      }
+    }
+    if (!placed)
+      return false;
+  }
+  // the number of taken slots above numberKeys
+  // equals the number of free slots below it
+  _remap.assign(_perfectHash._tableSize - numberKeys, 0);
+  std::uint32_t free = 0;
+  for (std::uint32_t position = numberKeys; position < _perfectHash._tableSize; ++position) {
+    if (!taken[position])
+      continue;
+    while (taken[free])
+      ++free;
+    _remap[position - numberKeys] = free++;
+  }
+  _keywordTable.assign(numberKeys, UNKNOWN_KEYWORD);
+  for (KeywordId id = 0; id < numberKeys; ++id) {
+    std::uint32_t slot = slots[id];
+    if (slot >= numberKeys)
+      slot = _remap[slot - numberKeys];
+    _keywordTable[slot] = id;
+  }
+  return true;
+}
+
+namespace {
+
+template <typename T>
+void appendSection(std::vector<char>& image, Header& header, SECTION section, std::span<const T> data) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  std::size_t offset = (image.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  std::size_t size = data.size_bytes();
+  image.resize(offset + size);
+  if (size > 0)
+    std::memcpy(image.data() + offset, data.data(), size);
+  header._sections[section] = { offset, size };
+}
+
+} // end of anonymous namespace
+
+void CatalogBuilder::build(std::vector<char>& image) const {
+  Header header;
+  image.assign(sizeof(Header), '\0');
+  appendSection(image, header, POOL, std::span<const char>(_text));
+  appendSection(image, header, KEYWORDS, std::span<const StringRef>(_keywords));
+  appendSection(image, header, PERFECTHASH, std::span<const PerfectHash>(&_perfectHash, 1));
+  appendSection(image, header, PILOTS, std::span<const std::uint16_t>(_pilots));
+  appendSection(image, header, REMAP, std::span<const std::uint32_t>(_remap));
+  appendSection(image, header, KEYWORDTABLE, std::span<const KeywordId>(_keywordTable));
+  appendSection(image, header, ADIDS, std::span<const StringRef>(_adIds));
+  appendSection(image, header, ADSIZES, std::span<const AdSize>(_adSizes));
+  appendSection(image, header, DEFAULTBIDS, std::span<const std::int64_t>(_defaultBids));
+  appendSection(image, header, INPUTS, std::span<const StringRef>(_inputs));
+  appendSection(image, header, BIDOFFSETS, std::span<const BidIndex>(_bidOffsets));
+  appendSection(image, header, BIDS, std::span<const AdBid>(_bids));
+  appendSection(image, header, POSTINGS, std::span<const BidIndex>(_postings));
+  appendSection(image, header, SIZES, std::span<const SizeBucket>(_sizes));
+  appendSection(image, header, SIZETABLE, std::span<const SizeId>(_sizeTable));
+  appendSection(image, header, INDEX, std::span<const IndexEntry>(_index));
+  appendSection(image, header, BLOOM, std::span<const std::uint64_t>(_bloom));
+  std::memcpy(image.data(), &header, sizeof(Header));
+}
@@ -0,0 +1,52 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "Ad.h"
+#include "CatalogImage.h"
+
+// Builds the binary catalog image from the ads text.
+// Used by the server to load the text file and by
+// adsCompilerX to write the image file.
+
+class CatalogBuilder : private boost::noncopyable {
+ public:
+  explicit CatalogBuilder(std::string_view text);
+  ~CatalogBuilder() = default;
+  void build(std::vector<char>& image) const;
+ private:
+  void collectKeywords(std::vector<std::vector<std::string_view>>& chunkKeywords);
+  void layout();
+  void buildIndex();
+  void buildSizeTable();
+  void buildPerfectHash();
+  bool placeKeywords(const std::vector<std::uint64_t>& hashes);
+  void buildBloom(catalogimage::SizeBucket& bucket, const std::vector<catalogimage::IndexEntry>& entries);
+  catalogimage::StringRef makeRef(std::string_view str) const;
+  const std::string_view _text;
+  std::vector<Ad> _ads;
+  std::vector<std::string_view> _keywordStrings;
+  std::vector<catalogimage::StringRef> _keywords;
+  catalogimage::PerfectHash _perfectHash;
+  std::vector<std::uint16_t> _pilots;
+  std::vector<std::uint32_t> _remap;
+  std::vector<KeywordId> _keywordTable;
+  std::vector<catalogimage::StringRef> _adIds;
+  std::vector<catalogimage::AdSize> _adSizes;
+  std::vector<std::int64_t> _defaultBids;
+  std::vector<catalogimage::StringRef> _inputs;
+  std::vector<BidIndex> _bidOffsets;
+  std::vector<AdBid> _bids;
+  std::vector<BidIndex> _postings;
+  std::vector<catalogimage::SizeBucket> _sizes;
+  std::vector<SizeId> _sizeTable;
+  std::vector<catalogimage::IndexEntry> _index;
+  std::vector<std::uint64_t> _bloom;
+};
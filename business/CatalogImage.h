@@ -0,0 +1,199 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "AdBid.h"
+
+// Layout of the binary ad catalog. The same image is built in
+// memory from the ads text file or mapped read-only from the file
+// written by adsCompilerX. All sections are arrays of trivially
+// copyable structures aligned to 8 bytes, strings are references
+// to the pool section which holds the original text.
+// The version must be incremented on any layout change.
+
+namespace catalogimage {
+
+constexpr std::array<char, 8> MAGIC{ 'A', 'D', 'C', 'A', 'T', 'L', 'O', 'G' };
+
+constexpr std::uint32_t VERSION = 4;
+
+constexpr std::size_t ALIGNMENT = 8;
+
+enum SECTION : unsigned {
+  POOL,
+  KEYWORDS,
+  PERFECTHASH,
+  PILOTS,
+  REMAP,
+  KEYWORDTABLE,
+  ADIDS,
+  ADSIZES,
+  DEFAULTBIDS,
+  INPUTS,
+  BIDOFFSETS,
+  BIDS,
+  POSTINGS,
+  SIZES,
+  SIZETABLE,
+  INDEX,
+  BLOOM,
+  NUMBERSECTIONS
+};
+
+struct Section {
+  std::uint64_t _offset = 0;
+  std::uint64_t _size = 0;
+};
+
+struct Header {
+  std::array<char, 8> _magic = MAGIC;
+  std::uint32_t _version = VERSION;
+  std::uint32_t _numberSections = NUMBERSECTIONS;
+  std::array<Section, NUMBERSECTIONS> _sections;
+};
+
+struct StringRef {
+  std::uint32_t _offset = 0;
+  std::uint32_t _size = 0;
+};
+
+struct AdSize {
+  std::uint32_t _width = 0;
+  std::uint32_t _height = 0;
+  auto operator <=> (const AdSize&) const = default;
+};
+
+// The size id is the index of the size in the SIZES section.
+// SIZETABLE is an open addressing table of size ids with the
+// capacity a power of 2, empty slots are UNKNOWN_SIZE.
+
+// Open addressing table of the keywords of one size,
+// _indexCapacity is a power of 2 or 0 for no keywords.
+// The Bloom filter of the same keywords has _bloomWords
+// words, a power of 2 or 0.
+
+struct SizeBucket {
+  AdSize _size;
+  AdIndex _begin = 0;
+  AdIndex _end = 0;
+  std::uint32_t _indexBegin = 0;
+  std::uint32_t _indexCapacity = 0;
+  std::uint32_t _bloomBegin = 0;
+  std::uint32_t _bloomWords = 0;
+};
+
+// _best is the highest bid in the range, the first
+// one in the ad order if there are several.
+
+struct IndexEntry {
+  KeywordId _keywordId = UNKNOWN_KEYWORD;
+  BidIndex _begin = 0;
+  BidIndex _end = 0;
+  BidIndex _best = 0;
+};
+
+// Hashes are a part of the format, std::hash is not stable
+// between builds.
+
+// FNV-1a
+constexpr std::uint64_t hashString(std::string_view str) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char ch : str) {
+    hash ^= ch;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// splitmix64 finalizer
+constexpr std::uint64_t hashInteger(std::uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31;
+  return value;
+}
+
+// maps the high 32 bits of the hash to [0, range)
+constexpr std::uint32_t reduce(std::uint64_t hash, std::uint32_t range) {
+  return ((hash >> 32) * range) >> 32;
+}
+
+// Minimal perfect hash of the keywords, PTHash style. The keyword
+// hash selects a bucket of about PERFECTHASH_BUCKET_SIZE keywords,
+// the 16 bit pilot of the bucket places its keywords in free slots
+// of a table 2% larger than the number of keywords. Slots above the
+// number of keywords are remapped to the free slots below it, the
+// result is a dense slot in [0, _numberKeys). The pilots take 3.2
+// bits per keyword and the remap 0.6, the slot to id table 32 more,
+// about 36 bits per keyword. Ids stay in the string order, which
+// the bids and the index rely on, so the slot is not the id.
+
+constexpr std::uint32_t PERFECTHASH_BUCKET_SIZE = 5;
+
+struct PerfectHash {
+  std::uint64_t _seed = 0;
+  std::uint32_t _numberKeys = 0;
+  std::uint32_t _tableSize = 0;
+  std::uint32_t _numberBuckets = 0;
+  std::uint32_t _reserved = 0;
+};
+
+// hash is hashString(keyword)
+constexpr std::uint64_t perfectHashKey(const PerfectHash& perfectHash, std::uint64_t hash) {
+  return hashInteger(hash ^ perfectHash._seed);
+}
+
+constexpr std::uint32_t perfectHashBucket(const PerfectHash& perfectHash, std::uint64_t key) {
+  return reduce(key, perfectHash._numberBuckets);
+}
+
+constexpr std::uint32_t perfectHashPosition(const PerfectHash& perfectHash,
+					    std::uint64_t key,
+					    std::uint16_t pilot) {
+  return reduce(hashInteger(key ^ (pilot * 0x9e3779b97f4a7c15ULL)), perfectHash._tableSize);
+}
+
+constexpr std::uint64_t hashSize(const AdSize& size) {
+  return hashInteger(static_cast<std::uint64_t>(size._width) << 32 | size._height);
+}
+
+// Blocked Bloom filter, all bits of a keyword are in one
+// word selected by the low bits of the hash, the bits in
+// the word are taken from the high bits. One memory access
+// per keyword, about 1% false positives with 10 bits per
+// keyword.
+
+constexpr std::size_t BLOOM_BITS_PER_KEYWORD = 10;
+
+constexpr unsigned BLOOM_HASHES = 4;
+
+constexpr std::uint64_t bloomMask(std::uint64_t hash) {
+  std::uint64_t mask = 0;
+  for (unsigned i = 0; i < BLOOM_HASHES; ++i)
+    mask |= 1ULL << ((hash >> (40 + 6 * i)) & 63);
+  return mask;
+}
+
+// hash is hashInteger(hashString(keyword))
+
+inline void bloomInsert(std::span<std::uint64_t> filter, std::uint64_t hash) {
+  filter[hash & (filter.size() - 1)] |= bloomMask(hash);
+}
+
+inline bool bloomMayContain(std::span<const std::uint64_t> filter, std::uint64_t hash) {
+  if (filter.empty())
+    return false;
+  std::uint64_t mask = bloomMask(hash);
+  return (filter[hash & (filter.size() - 1)] & mask) == mask;
+}
+
+} // end of namespace catalogimage
@@ -0,0 +1,28 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include "KeywordDictionary.h"
+
+using namespace catalogimage;
+
+KeywordDictionary::KeywordDictionary(std::string_view pool,
+				     std::span<const StringRef> keywords,
+				     const PerfectHash& perfectHash,
+				     std::span<const std::uint16_t> pilots,
+				     std::span<const std::uint32_t> remap,
+				     std::span<const KeywordId> table) :
+  _pool(pool), _keywords(keywords), _perfectHash(perfectHash),
+  _pilots(pilots), _remap(remap), _table(table) {}
+
+KeywordId KeywordDictionary::find(std::string_view keyword, std::uint64_t hash) const {
+  if (_perfectHash._numberKeys == 0)
+    return UNKNOWN_KEYWORD;
+  std::uint64_t key = perfectHashKey(_perfectHash, hash);
+  std::uint16_t pilot = _pilots[perfectHashBucket(_perfectHash, key)];
+  std::uint32_t slot = perfectHashPosition(_perfectHash, key, pilot);
+  if (slot >= _perfectHash._numberKeys)
+    slot = _remap[slot - _perfectHash._numberKeys];
+  KeywordId id = _table[slot];
+  return getKeyword(id) == keyword ? id : UNKNOWN_KEYWORD;
+}
@@ -0,0 +1,46 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#pragma once
+
+#include <span>
+#include <string_view>
+
+#include "CatalogImage.h"
+
+// Read-only view of the keyword sections of the catalog image.
+// Keyword ids are dense and ordered like the keyword strings,
+// sorting ids is equivalent to sorting strings. The lookup is
+// a minimal perfect hash, the slot holds the id of the only
+// keyword which can be there, one string compare rejects
+// unknown keywords.
+
+class KeywordDictionary {
+ public:
+  KeywordDictionary() = default;
+  KeywordDictionary(std::string_view pool,
+		    std::span<const catalogimage::StringRef> keywords,
+		    const catalogimage::PerfectHash& perfectHash,
+		    std::span<const std::uint16_t> pilots,
+		    std::span<const std::uint32_t> remap,
+		    std::span<const KeywordId> table);
+  ~KeywordDictionary() = default;
+  KeywordId find(std::string_view keyword) const {
+    return find(keyword, catalogimage::hashString(keyword));
+  }
+  // hash is catalogimage::hashString(keyword)
+  KeywordId find(std::string_view keyword, std::uint64_t hash) const;
+  std::string_view getKeyword(KeywordId id) const {
+    const catalogimage::StringRef& ref = _keywords[id];
+    return { _pool.data() + ref._offset, ref._size };
+  }
+  std::size_t size() const { return _keywords.size(); }
+ private:
+  std::string_view _pool;
+  std::span<const catalogimage::StringRef> _keywords;
+  catalogimage::PerfectHash _perfectHash;
+  std::span<const std::uint16_t> _pilots;
+  std::span<const std::uint32_t> _remap;
+  std::span<const KeywordId> _table;
+};
@@ -0,0 +1,81 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "IOUtility.h"
+
+// Money is kept in integer cents from the ads file to the
+// reply, there is no floating point on the way and the
+// output does not depend on the compiler or the library.
+
+namespace money {
+
+constexpr std::int64_t CENTS = 100;
+
+// Decimal amount to cents, "12", "12.3", ".5", more than 2
+// decimals are rounded half away from zero like std::lround.
+// Like std::from_chars the number is the longest valid prefix.
+// Throws std::runtime_error if there is none or on overflow.
+
+constexpr std::int64_t parse(std::string_view str) {
+  constexpr std::int64_t MAX_UNITS = INT64_MAX / CENTS - 1;
+  bool negative = !str.empty() && str.front() == '-';
+  if (negative)
+    str.remove_prefix(1);
+  std::int64_t units = 0;
+  std::size_t pos = 0;
+  for (; pos < str.size() && str[pos] >= '0' && str[pos] <= '9'; ++pos) {
+    units = units * 10 + (str[pos] - '0');
+    if (units > MAX_UNITS)
+      throw std::runtime_error("money overflow");
+  }
+  bool hasDigits = pos > 0;
+  std::int64_t cents = 0;
+  if (pos < str.size() && str[pos] == '.') {
+    std::int64_t scale = CENTS;
+    bool roundUp = false;
+    for (++pos; pos < str.size() && str[pos] >= '0' && str[pos] <= '9'; ++pos) {
+      hasDigits = true;
+      if (scale > 1) {
+	scale /= 10;
+	cents += (str[pos] - '0') * scale;
+      }
+      else if (scale == 1) {
+	roundUp = str[pos] >= '5';
+	scale = 0;
+      }
+    }
+    cents += roundUp;
+  }
+  if (!hasDigits)
+    throw std::runtime_error("money is not a number");
+  cents += units * CENTS;
+  return negative ? -cents : cents;
+}
+
+// One decimal, the format of the replies, cents rounded to
+// tenths half away from zero. Amounts with one decimal, all
+// of the ads file, print as before. Amounts with two decimals
+// may differ from the double formatting this replaced, which
+// rounded the binary value: 12.35 was "12.3", 0.25 was "0.2",
+// both are rounded up here.
+
+inline void print(std::int64_t cents, std::string& output) {
+  bool negative = cents < 0;
+  std::uint64_t tenths = ((negative ? -static_cast<std::uint64_t>(cents) : cents) + 5) / 10;
+  if (negative && tenths != 0)
+    output.push_back('-');
+  using ioutility::operator<<;
+  output << tenths / 10;
+  output.push_back('.');
+  output.push_back(static_cast<char>('0' + tenths % 10));
+}
+
+} // end of namespace money
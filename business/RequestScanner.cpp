@@ -0,0 +1,265 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include "RequestScanner.h"
+
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr std::string_view SIZE_START_REG{ "size" };
+constexpr std::string_view SIZE_START_ALT{ "ad_width" };
+constexpr std::string_view START_KEYWORDS1{ "kw" };
+constexpr std::string_view START_KEYWORDS2{ "keywords" };
+constexpr char VALUE_START = '=';
+constexpr char KEYWORDS_END = '&';
+constexpr auto NPOS = std::string_view::npos;
+
+constexpr bool isWidth(REQUESTFORMAT format) {
+  return format == REQUESTFORMAT::WIDTH_KW || format == REQUESTFORMAT::WIDTH_KEYWORDS;
+}
+
+constexpr bool isKeywords(REQUESTFORMAT format) {
+  return format == REQUESTFORMAT::SIZE_KEYWORDS || format == REQUESTFORMAT::WIDTH_KEYWORDS;
+}
+
+constexpr REQUESTFORMAT makeFormat(bool width, bool keywords) {
+  if (width)
+    return keywords ? REQUESTFORMAT::WIDTH_KEYWORDS : REQUESTFORMAT::WIDTH_KW;
+  return keywords ? REQUESTFORMAT::SIZE_KEYWORDS : REQUESTFORMAT::SIZE_KW;
+}
+
+// Fed with '=' positions in increasing order. A field name
+// is recognized by the bytes before '=', the first occurrence
+// of every name is kept like in string_view::find. The end
+// of the keywords is found once the field is selected.
+// "size" and "kw" take precedence and are probed in every
+// format, "ad_width" and "keywords" only if the format has
+// them. The result is valid if the request is in FORMAT.
+
+template <REQUESTFORMAT FORMAT>
+class ScanState {
+  static constexpr bool ANY = FORMAT == REQUESTFORMAT::ANY;
+  static constexpr bool WIDTH = ANY || isWidth(FORMAT);
+  static constexpr bool KEYWORDS = ANY || isKeywords(FORMAT);
+public:
+  explicit ScanState(std::string_view request) : _request(request) {}
+
+  void onValueStart(std::size_t pos) {
+    if (pos > 0) {
+      // the last letter of the name selects the candidate
+      switch (_request[pos - 1]) {
+      case SIZE_START_REG.back():
+	if (_size == NPOS && isName(pos, SIZE_START_REG))
+	  _size = pos - SIZE_START_REG.size();
+	break;
+      case SIZE_START_ALT.back():
+	if constexpr (WIDTH)
+	  if (_alt == NPOS && isName(pos, SIZE_START_ALT))
+	    _alt = pos - SIZE_START_ALT.size();
+	break;
+      case START_KEYWORDS1.back():
+	if (_kw == NPOS && isName(pos, START_KEYWORDS1))
+	  _kw = pos + 1;
+	break;
+      case START_KEYWORDS2.back():
+	if constexpr (KEYWORDS)
+	  if (_keywords == NPOS && isName(pos, START_KEYWORDS2))
+	    _keywords = pos + 1;
+	break;
+      default:
+	break;
+      }
+    }
+  }
+
+  // "size=" and "kw=" take precedence, nothing else can change.
+  // Other formats are confirmed at the end of the request or
+  // rejected by a name taking precedence.
+  bool done() const {
+    if constexpr (ANY || FORMAT == REQUESTFORMAT::SIZE_KW)
+      return _size != NPOS && _kw != NPOS;
+    else
+      return (isWidth(FORMAT) && _size != NPOS) || (isKeywords(FORMAT) && _kw != NPOS);
+  }
+
+  RequestFields getFields() const {
+    RequestFields fields;
+    if (std::size_t start = _size != NPOS ? _size : _alt; start != NPOS)
+      fields._size = _request.substr(start);
+    if (_kw != NPOS)
+      fields._keywords = getValue(_kw);
+    else if (_keywords != NPOS)
+      fields._keywords = getValue(_keywords);
+    if ((_size != NPOS || _alt != NPOS) && (_kw != NPOS || _keywords != NPOS))
+      fields._format = makeFormat(_size == NPOS, _kw == NPOS);
+    return fields;
+  }
+
+private:
+  bool isName(std::size_t pos, std::string_view name) const {
+    return pos >= name.size() && _request.substr(pos - name.size(), name.size()) == name;
+  }
+
+  std::string_view getValue(std::size_t start) const {
+    std::size_t end = _request.find(KEYWORDS_END, start);
+    return _request.substr(start, end == NPOS ? NPOS : end - start);
+  }
+
+  const std::string_view _request;
+  std::size_t _size = NPOS;
+  std::size_t _alt = NPOS;
+  std::size_t _kw = NPOS;
+  std::size_t _keywords = NPOS;
+};
+
+template <typename STATE>
+void scanTail(std::string_view request, std::size_t pos, STATE& state) {
+  for (; pos < request.size() && !state.done(); ++pos)
+    if (request[pos] == VALUE_START)
+      state.onValueStart(pos);
+}
+
+template <REQUESTFORMAT FORMAT>
+RequestFields scanScalar(std::string_view request) {
+  ScanState<FORMAT> state(request);
+  scanTail(request, 0, state);
+  return state.getFields();
+}
+
+#if defined(__x86_64__)
+
+// mask has a bit for every '=' in the block at pos
+template <typename STATE>
+bool visit(std::uint32_t mask, std::size_t pos, STATE& state) {
+  for (; mask != 0; mask &= mask - 1) {
+    state.onValueStart(pos + std::countr_zero(mask));
+    if (state.done())
+      return true;
+  }
+  return false;
+}
+
+template <REQUESTFORMAT FORMAT>
+RequestFields scanSSE2(std::string_view request) {
+  ScanState<FORMAT> state(request);
+  const __m128i valueStart = _mm_set1_epi8(VALUE_START);
+  std::size_t pos = 0;
+  for (; pos + sizeof(__m128i) <= request.size(); pos += sizeof(__m128i)) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(request.data() + pos));
+    __m128i matches = _mm_cmpeq_epi8(block, valueStart);
+    if (visit(_mm_movemask_epi8(matches), pos, state))
+      return state.getFields();
+  }
+  scanTail(request, pos, state);
+  return state.getFields();
+}
+
+template <REQUESTFORMAT FORMAT>
+[[gnu::target("avx2")]]
+RequestFields scanAVX2(std::string_view request) {
+  ScanState<FORMAT> state(request);
+  const __m256i valueStart = _mm256_set1_epi8(VALUE_START);
+  std::size_t pos = 0;
+  for (; pos + sizeof(__m256i) <= request.size(); pos += sizeof(__m256i)) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(request.data() + pos));
+    __m256i matches = _mm256_cmpeq_epi8(block, valueStart);
+    if (visit(_mm256_movemask_epi8(matches), pos, state))
+      return state.getFields();
+  }
+  scanTail(request, pos, state);
+  return state.getFields();
+}
+
+#endif
+
+template <SCANNER SCANNERTYPE, REQUESTFORMAT FORMAT>
+RequestFields scanInstance(std::string_view request) {
+#if defined(__x86_64__)
+  if constexpr (SCANNERTYPE == SCANNER::AVX2)
+    return scanAVX2<FORMAT>(request);
+  else if constexpr (SCANNERTYPE == SCANNER::SSE2)
+    return scanSSE2<FORMAT>(request);
+  else
+#endif
+    return scanScalar<FORMAT>(request);
+}
+
+// a request in another format is scanned again with ANY
+
+template <SCANNER SCANNERTYPE, REQUESTFORMAT FORMAT>
+RequestFields scanFormat(std::string_view request) {
+  RequestFields fields = scanInstance<SCANNERTYPE, FORMAT>(request);
+  if constexpr (FORMAT != REQUESTFORMAT::ANY)
+    if (fields._format != FORMAT)
+      return scanInstance<SCANNERTYPE, REQUESTFORMAT::ANY>(request);
+  return fields;
+}
+
+template <SCANNER SCANNERTYPE>
+constexpr auto makeTable() {
+  return std::array{ scanFormat<SCANNERTYPE, REQUESTFORMAT::SIZE_KW>,
+		     scanFormat<SCANNERTYPE, REQUESTFORMAT::SIZE_KEYWORDS>,
+		     scanFormat<SCANNERTYPE, REQUESTFORMAT::WIDTH_KW>,
+		     scanFormat<SCANNERTYPE, REQUESTFORMAT::WIDTH_KEYWORDS>,
+		     scanFormat<SCANNERTYPE, REQUESTFORMAT::ANY> };
+}
+
+} // end of anonymous namespace
+
+const RequestScanner::ScanTable RequestScanner::_scan = getTable(getBest());
+
+bool RequestScanner::isSupported(SCANNER scanner) {
+  switch (scanner) {
+  case SCANNER::SCALAR:
+    return true;
+#if defined(__x86_64__)
+  case SCANNER::SSE2:
+    return true;
+  case SCANNER::AVX2:
+    // may run during static initialization
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+SCANNER RequestScanner::getBest() {
+  if (isSupported(SCANNER::AVX2))
+    return SCANNER::AVX2;
+  if (isSupported(SCANNER::SSE2))
+    return SCANNER::SSE2;
+  return SCANNER::SCALAR;
+}
+
+RequestFields RequestScanner::scan(std::string_view request,
+				   SCANNER scanner,
+				   REQUESTFORMAT format) {
+  return getTable(scanner)[static_cast<unsigned>(format)](request);
+}
+
+const RequestScanner::ScanTable& RequestScanner::getTable(SCANNER scanner) {
+  static constexpr ScanTable scalarTable = makeTable<SCANNER::SCALAR>();
+#if defined(__x86_64__)
+  static constexpr ScanTable sse2Table = makeTable<SCANNER::SSE2>();
+  static constexpr ScanTable avx2Table = makeTable<SCANNER::AVX2>();
+#endif
+  switch (scanner) {
+#if defined(__x86_64__)
+  case SCANNER::SSE2:
+    return sse2Table;
+  case SCANNER::AVX2:
+    return avx2Table;
+#endif
+  default:
+    return scalarTable;
+  }
+}
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#pragma once
+
+#include <array>
+#include <string_view>
+
+// Fields of the request found in one pass. The scan visits
+// only '=' positions located 16 or 32 bytes at a time,
+// AVX2 or SSE2 is selected at runtime, the scalar version is
+// the reference and the fallback.
+// _size starts with "size=" or "ad_width=", the first one
+// found in this order, and extends to the end of the request.
+// _keywords is the value of "kw=" or "keywords=" up to '&'.
+// Empty views if not found.
+
+// Field names of the request. Requests of one batch almost
+// always share the format, a parser instantiated for the
+// format probes only its names and the names taking
+// precedence over them. ANY probes all names, it is also
+// the format of a request without a size or keywords.
+
+enum class REQUESTFORMAT : unsigned {
+  SIZE_KW,
+  SIZE_KEYWORDS,
+  WIDTH_KW,
+  WIDTH_KEYWORDS,
+  ANY
+};
+
+struct RequestFields {
+  std::string_view _size;
+  std::string_view _keywords;
+  REQUESTFORMAT _format = REQUESTFORMAT::ANY;
+};
+
+enum class SCANNER : int {
+  SCALAR,
+  SSE2,
+  AVX2
+};
+
+// The format is a hint, a request in another format is
+// scanned again with ANY, the result does not depend on it.
+
+class RequestScanner {
+ public:
+  static RequestFields scan(std::string_view request,
+			    REQUESTFORMAT format = REQUESTFORMAT::ANY) {
+    return _scan[static_cast<unsigned>(format)](request);
+  }
+  static RequestFields scan(std::string_view request,
+			    SCANNER scanner,
+			    REQUESTFORMAT format = REQUESTFORMAT::ANY);
+  static bool isSupported(SCANNER scanner);
+  static SCANNER getBest();
+ private:
+  RequestScanner() = delete;
+  ~RequestScanner() = delete;
+  using ScanFunction = RequestFields (*)(std::string_view);
+  using ScanTable = std::array<ScanFunction, static_cast<unsigned>(REQUESTFORMAT::ANY) + 1>;
+  static const ScanTable& getTable(SCANNER scanner);
+  static const ScanTable _scan;
+};
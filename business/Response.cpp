@@ -0,0 +1,63 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include "Response.h"
+
+void Response::reset(std::size_t numberArenas, std::size_t size) {
+  if (_arenas.size() < numberArenas)
+    _arenas.resize(numberArenas);
+  for (std::string& arena : _arenas)
+    arena.clear();
+  _replies.assign(size, ReplyRef());
+}
+
+// Reply may be a range of the same arena, a copy of a reply
+// in the same group. It is read before a reallocation frees it.
+
+void Response::store(unsigned worker, std::size_t index, std::string_view reply) {
+  std::string& arena = _arenas[worker];
+  _replies[index] = { worker, static_cast<std::uint32_t>(reply.size()), arena.size() };
+  arena.append(reply);
+}
+
+std::string_view Response::operator[](std::size_t index) const {
+  const ReplyRef& reply = _replies[index];
+  return std::string_view(_arenas[reply._arena]).substr(reply._offset, reply._size);
+}
+
+// One thread, or one thread answering the whole batch,
+// writes the replies in the order of the requests.
+
+std::size_t Response::assemble(std::string& output, std::size_t begin, std::size_t frameSize) {
+  output.clear();
+  if (begin >= _replies.size())
+    return _replies.size();
+  std::size_t end = begin + 1;
+  std::size_t size = _replies[begin]._size;
+  for (; end < _replies.size(); ++end) {
+    if (frameSize > 0 && size + _replies[end]._size > frameSize)
+      break;
+    size += _replies[end]._size;
+  }
+  if (begin == 0 && end == _replies.size()) {
+    std::uint32_t arena = _replies.front()._arena;
+    std::size_t offset = 0;
+    bool inOrder = true;
+    for (const ReplyRef& reply : _replies) {
+      if (reply._arena != arena || reply._offset != offset) {
+	inOrder = false;
+	break;
+      }
+      offset += reply._size;
+    }
+    if (inOrder && offset == _arenas[arena].size()) {
+      output.swap(_arenas[arena]);
+      return end;
+    }
+  }
+  output.reserve(size);
+  for (std::size_t index = begin; index < end; ++index)
+    output.append((*this)[index]);
+  return end;
+}
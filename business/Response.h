@@ -0,0 +1,37 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Replies of a batch. Every worker thread appends the replies
+// it produces to its own arena, the reply of a request is a
+// range in one of the arenas. The arenas keep their capacity
+// for the next batch, there is no string per request.
+
+class Response {
+  struct ReplyRef {
+    std::uint32_t _arena = 0;
+    std::uint32_t _size = 0;
+    std::size_t _offset = 0;
+  };
+  std::vector<std::string> _arenas;
+  std::vector<ReplyRef> _replies;
+ public:
+  void reset(std::size_t numberArenas, std::size_t size);
+  // reply is copied to the arena of the worker
+  void store(unsigned worker, std::size_t index, std::string_view reply);
+  std::string_view operator[](std::size_t index) const;
+  std::size_t size() const { return _replies.size(); }
+  // The replies in the order of the requests starting with
+  // begin, at least one and at most frameSize bytes if it is
+  // not 0. Returns the index of the next reply. If one arena
+  // already has all of them in this order it is swapped with
+  // output.
+  std::size_t assemble(std::string& output, std::size_t begin = 0, std::size_t frameSize = 0);
+};
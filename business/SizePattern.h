@@ -0,0 +1,127 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#pragma once
+
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+
+using SIZETUPLE = std::tuple<unsigned, unsigned>;
+
+// Size matcher of the UseRegex mode for a subset of the regex
+// syntax: literal characters, '\' escaping a punctuation
+// character, and exactly two \d+ groups, width and height, like
+// "size=\d+x\d+". Other escapes like \w or \s are classes in
+// a regex and are rejected. A literal after a group can not be
+// a digit, greedy groups never backtrack and the search is linear.
+// Built at compile time for the default patterns, from
+// ServerOptions at startup for configured ones. Literals are
+// copied, search works on string_view without allocations.
+
+class SizePattern {
+  enum PARTS : unsigned {
+    PREFIX,
+    SEPARATOR,
+    SUFFIX,
+    NUMBERPARTS
+  };
+ public:
+  static constexpr std::size_t MAX_LENGTH = 64;
+
+  // throws std::invalid_argument, a compile error in constexpr context
+  constexpr explicit SizePattern(std::string_view pattern) {
+    unsigned part = PREFIX;
+    for (std::size_t i = 0; i < pattern.size(); ++i) {
+      char ch = pattern[i];
+      if (pattern.substr(i, DIGITS.size()) == DIGITS) {
+	if (part == SUFFIX)
+	  throw std::invalid_argument("more than two \\d+ groups");
+	++part;
+	i += DIGITS.size() - 1;
+	continue;
+      }
+      if (ch == '\\') {
+	if (++i == pattern.size())
+	  throw std::invalid_argument("trailing escape");
+	ch = pattern[i];
+	if (isDigit(ch) || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'))
+	  throw std::invalid_argument("unsupported escape");
+      }
+      else if (std::string_view(".*+?()[]{}|^$").find(ch) != std::string_view::npos)
+	throw std::invalid_argument("unsupported regex syntax");
+      if (_length == MAX_LENGTH)
+	throw std::invalid_argument("pattern is too long");
+      if (part != PREFIX && _sizes[part] == 0 && isDigit(ch))
+	throw std::invalid_argument("digit after \\d+");
+      _literals[_length++] = ch;
+      ++_sizes[part];
+    }
+    if (part != SUFFIX)
+      throw std::invalid_argument("two \\d+ groups expected");
+  }
+
+  // leftmost match like regex_search, false if none
+  constexpr bool search(std::string_view input, SIZETUPLE& sizeKey) const {
+    std::string_view prefix = getPart(PREFIX);
+    for (std::size_t start = input.find(prefix); start != std::string_view::npos;
+	 start = input.find(prefix, start + 1)) {
+      if (match(input.substr(start + prefix.size()), sizeKey))
+	return true;
+    }
+    return false;
+  }
+
+ private:
+  static constexpr std::string_view DIGITS{ "\\d+" };
+
+  static constexpr bool isDigit(char ch) { return ch >= '0' && ch <= '9'; }
+
+  constexpr std::string_view getPart(unsigned part) const {
+    std::size_t offset = 0;
+    for (unsigned i = 0; i < part; ++i)
+      offset += _sizes[i];
+    return { _literals.data() + offset, _sizes[part] };
+  }
+
+  // digits of a greedy \d+, empty if none
+  static constexpr std::string_view takeDigits(std::string_view& input) {
+    std::size_t length = 0;
+    while (length < input.size() && isDigit(input[length]))
+      ++length;
+    std::string_view digits = input.substr(0, length);
+    input.remove_prefix(length);
+    return digits;
+  }
+
+  // throws on overflow like std::from_chars in the regex version
+  static constexpr unsigned toNumber(std::string_view digits) {
+    unsigned value = 0;
+    for (char ch : digits) {
+      unsigned digit = ch - '0';
+      if (value > (std::numeric_limits<unsigned>::max() - digit) / 10)
+	throw std::runtime_error("size value is out of range");
+      value = value * 10 + digit;
+    }
+    return value;
+  }
+
+  constexpr bool match(std::string_view input, SIZETUPLE& sizeKey) const {
+    std::string_view width = takeDigits(input);
+    if (width.empty() || !input.starts_with(getPart(SEPARATOR)))
+      return false;
+    input.remove_prefix(_sizes[SEPARATOR]);
+    std::string_view height = takeDigits(input);
+    if (height.empty() || !input.starts_with(getPart(SUFFIX)))
+      return false;
+    sizeKey = { toNumber(width), toNumber(height) };
+    return true;
+  }
+
+  std::array<char, MAX_LENGTH> _literals{};
+  std::array<std::size_t, NUMBERPARTS> _sizes{};
+  std::size_t _length = 0;
+};
@@ -4,28 +4,27 @@
 
 #include "Transaction.h"
 
+#include <bit>
 #include <cctype>
+#include <limits>
 
 #include <boost/charconv.hpp>
-#include <boost/regex.hpp>
 
 #include "Ad.h"
-#include "AdBid.h"
+#include "AdCatalog.h"
 #include "IOUtility.h"
 #include "Logger.h"
+#include "Money.h"
+#include "RequestScanner.h"
 #include "ServerOptions.h"
+#include "SizePattern.h"
 #include "Utility.h"
 
 namespace {
 
 constexpr const char* INVALID_REQUEST{ " Invalid request\n" };
 constexpr const char* EMPTY_REPLY{ "0, 0.0\n" };
-constexpr auto START_KEYWORDS1{ "kw=" };
 constexpr char KEYWORD_SEP = '+';
-constexpr char KEYWORDS_END = '&';
-constexpr const char* START_KEYWORDS2{ "keywords=" };
-constexpr auto SIZE_START_REG{ "size=" };
-constexpr auto SIZE_START_ALT{ "ad_width=" };
 constexpr auto DELIMITER(", ");
 constexpr auto MATCHES{ " #matches=" };
 constexpr auto REQUESTKEYWORDS{ "\nrequest keywords:\n" };
@@ -35,108 +34,277 @@ constexpr auto STARS{ "*****" };
 constexpr auto MATCHINGADS{ "matching ads:\n" };
 constexpr auto MATCH{ " match:" };
 constexpr auto ENDING{ "\n*****\n" };
+constexpr SizePattern SIZE_PATTERN_REG("size=\\d+x\\d+");
+constexpr SizePattern SIZE_PATTERN_ALT("ad_width=\\d+&ad_height=\\d+");
+
+// Distinct keywords of a batch of requests of one size with
+// the best bid of every keyword in the size. Open addressing
+// by keyword hash, the capacity is a power of 2 at least twice
+// the number of keywords. Keywords are copied to a pool, the
+// comparisons stay in the cache while the requests are read
+// once. Reused by the thread.
+
+class BatchKeywords {
+public:
+  void reset() {
+    _slots.assign(MIN_CAPACITY, EMPTY);
+    _pool.clear();
+    _keywords.clear();
+    _hashes.clear();
+  }
+
+  // Splits keywords like utility::split and inserts them, the
+  // hash is calculated in the same pass. The slots of the
+  // keywords are appended to slots.
+  void insertAll(std::string_view keywords, std::vector<std::uint32_t>& slots) {
+    std::uint64_t hash = HASH_START;
+    std::size_t start = 0;
+    for (std::size_t pos = 0; pos < keywords.size(); ++pos) {
+      if (keywords[pos] == KEYWORD_SEP) {
+	slots.push_back(insert(keywords.substr(start, pos - start), hash));
+	hash = HASH_START;
+	start = pos + 1;
+      }
+      else
+	hash = (hash ^ static_cast<unsigned char>(keywords[pos])) * HASH_PRIME;
+    }
+    if (start < keywords.size())
+      slots.push_back(insert(keywords.substr(start), hash));
+  }
+
+  // returns the number of keywords passing the Bloom
+  // filter without a match
+  std::size_t join(const AdCatalog& catalog, const SizeBucket& bucket) {
+    std::size_t falsePositives = 0;
+    _bids.assign(_keywords.size(), nullptr);
+    _resolved.assign(_keywords.size(), false);
+    for (std::size_t slot = 0; slot < _keywords.size(); ++slot) {
+      if (!catalog.mayContain(bucket, _hashes[slot]))
+	continue;
+      KeywordId keywordId = catalog.getDictionary().find(getKeyword(slot), _hashes[slot]);
+      if (keywordId == UNKNOWN_KEYWORD) {
+	++falsePositives;
+	continue;
+      }
+      _resolved[slot] = true;
+      _bids[slot] = catalog.getBestBid(bucket, keywordId);
+      if (_bids[slot] == nullptr)
+	++falsePositives;
+    }
+    return falsePositives;
+  }
+
+  const AdBid* getBid(std::uint32_t slot) const { return _bids[slot]; }
+
+  bool isResolved(std::uint32_t slot) const { return _resolved[slot]; }
+
+private:
+  // same as catalogimage::hashString
+  static constexpr std::uint64_t HASH_START = catalogimage::hashString({});
+  static constexpr std::uint64_t HASH_PRIME = 1099511628211ULL;
+  static_assert((HASH_START ^ 'a') * HASH_PRIME == catalogimage::hashString("a"));
+
+  // hash is catalogimage::hashString(keyword)
+  std::uint32_t insert(std::string_view keyword, std::uint64_t hash) {
+    if (2 * (_keywords.size() + 1) > _slots.size())
+      grow();
+    std::size_t mask = _slots.size() - 1;
+    for (std::size_t pos = catalogimage::hashInteger(hash) & mask;; pos = (pos + 1) & mask) {
+      std::uint32_t slot = _slots[pos];
+      if (slot == EMPTY) {
+	slot = _keywords.size();
+	_slots[pos] = slot;
+	_keywords.push_back({ static_cast<std::uint32_t>(_pool.size()), static_cast<std::uint32_t>(keyword.size()) });
+	_pool.append(keyword);
+	_hashes.push_back(hash);
+	return slot;
+      }
+      if (_hashes[slot] == hash && getKeyword(slot) == keyword)
+	return slot;
+    }
+  }
+
+  std::string_view getKeyword(std::uint32_t slot) const {
+    return { _pool.data() + _keywords[slot]._offset, _keywords[slot]._size };
+  }
+
+  void grow() {
+    _slots.assign(2 * _slots.size(), EMPTY);
+    std::size_t mask = _slots.size() - 1;
+    for (std::uint32_t slot = 0; slot < _keywords.size(); ++slot) {
+      std::size_t pos = catalogimage::hashInteger(_hashes[slot]) & mask;
+      while (_slots[pos] != EMPTY)
+	pos = (pos + 1) & mask;
+      _slots[pos] = slot;
+    }
+  }
+
+  static constexpr std::uint32_t EMPTY = std::numeric_limits<std::uint32_t>::max();
+  static constexpr std::size_t MIN_CAPACITY = 1024;
+  std::vector<std::uint32_t> _slots;
+  std::string _pool;
+  std::vector<catalogimage::StringRef> _keywords;
+  std::vector<std::uint64_t> _hashes;
+  std::vector<const AdBid*> _bids;
+  std::vector<bool> _resolved;
+};
 
 } // end of anonymous namespace
 
 using ioutility::removeNonDigits;
 
-thread_local std::vector<AdBid> Transaction::_bids;
+thread_local std::vector<BidIndex> Transaction::_bids;
 thread_local std::vector<std::string_view> Transaction::_keywords;
+thread_local std::vector<KeywordId> Transaction::_keywordIds;
 thread_local std::string Transaction::_output;
+std::mutex Transaction::_bloomMutex;
+std::vector<const Transaction::BloomStatistics*> Transaction::_bloomThreads;
+std::size_t Transaction::_bloomRetiredShortCircuits = 0;
+std::size_t Transaction::_bloomRetiredFalsePositives = 0;
+thread_local Transaction::BloomStatistics Transaction::_bloomStatistics;
+std::vector<SizePattern> Transaction::_sizePatterns{ SIZE_PATTERN_REG, SIZE_PATTERN_ALT };
 
 using ioutility::operator<<;
 
-Transaction::Transaction(const Request& request) :
-  _sizeKey(createSizeKey(request._input)) {
-  init(request._input);
+Transaction::Transaction(const AdCatalog& catalog, const Request& request) :
+  _catalog(catalog), _sizeKey(request._sizeKey) {
+  init(request);
 }
 
-Transaction::Transaction(const SIZETUPLE& sizeKey, const Request& request) :
-  _sizeKey(sizeKey)  {
-  init(request._input);
-}
-
-void Transaction::init(std::string_view input) {
+void Transaction::init(const Request& request) {
   clear();
+  std::string_view input = request._input;
   if (_sizeKey == ZERO_SIZE) {
     _invalid = true;
     LogError << "invalid request, ZERO_SIZE sizeKey, input:" << input << '\n';
     return;
   }
-  auto pos = input.find(']');
-  if (pos != std::string_view::npos && input[0] == '[') {
-    _id = { input.data(), pos + 1 };
+  if (_id = getId(input); !_id.empty()) {
     input.remove_prefix(_id.size());
     _request = input;
-    if (!parseKeywords(START_KEYWORDS1))
-      parseKeywords(START_KEYWORDS2);
+    breakKeywords(request._keywords);
   }
 }
 
-const std::vector<AdPtr> emptyAdVector;
+// "[id]" at the start of the input, empty if none
 
-std::string_view Transaction::processRequestSort(const SIZETUPLE& sizeKey,
-						 const Request& request,
-						 bool diagnostics) noexcept {
-  Transaction transaction(sizeKey, request);
+std::string_view Transaction::getId(std::string_view input) {
+  auto pos = input.find(']');
+  if (pos != std::string_view::npos && input[0] == '[')
+    return input.substr(0, pos + 1);
+  return {};
+}
+
+std::string_view Transaction::processRequest(const Request& request,
+					     const AdCatalog& catalog,
+					     bool diagnostics) noexcept {
+  Transaction transaction(catalog, request);
   if (request._input.empty()) {
     LogError << "request is empty." << '\n';
     transaction._invalid = true;
     return _output << "[unknown]" << INVALID_REQUEST;
   }
-  static thread_local std::reference_wrapper<const std::vector<AdPtr>> adVector = emptyAdVector;
-  static thread_local SIZETUPLE prevKey;
-  if (sizeKey != prevKey) {
-    prevKey = sizeKey;
-    adVector = Ad::getAdsBySize(sizeKey);
-  }
-  transaction.matchAds(adVector);
-  if (diagnostics)
+  const SizeBucket& bucket = catalog.getBucket(request._sizeId);
+  transaction.resolveKeywords(bucket);
+  if (diagnostics) {
+    transaction.matchAds(bucket);
     transaction.printDiagnostics();
+  }
   else {
-    if (transaction._noMatch)
-      _output << transaction._id << ' ' << EMPTY_REPLY;
-    else
-      transaction.printSummary();
+    if (!transaction._noMatch)
+      transaction.matchBestBid(bucket);
+    printReply(transaction._id, transaction._noMatch ? nullptr : transaction._winningBid, catalog);
   }
   return _output;
 }
 
-std::string_view Transaction::processRequestNoSort(const Request& request,
-						   bool diagnostics) noexcept {
-  Transaction transaction(request);
-  if (request._input.empty()) {
-    LogError << "request is empty." << '\n';
-    transaction._invalid = true;
-    return _output << "[unknown]" << INVALID_REQUEST;
-  }
-  static thread_local std::reference_wrapper<const std::vector<AdPtr>> adVector = emptyAdVector;
-  static thread_local SIZETUPLE prevKey;
-  if (request._sizeKey != prevKey) {
-    prevKey = request._sizeKey;
-    adVector = Ad::getAdsBySize(request._sizeKey);
+// Requests of one size are joined with the ads of the size.
+// The keywords of all requests are collected in one table, a
+// keyword is looked up in the Bloom filter, the dictionary and
+// the size index once for the batch. The winner of a request is
+// the best of the bids of its keywords, as in matchBestBid.
+// Diagnostics and requests without a known size take the
+// single request path.
+
+void Transaction::processBatch(const std::vector<Request>& requests,
+			       std::span<const std::size_t> indices,
+			       const AdCatalog& catalog,
+			       Response& response,
+			       unsigned worker) noexcept {
+  if (indices.empty())
+    return;
+  thread_local BatchKeywords batchKeywords;
+  thread_local std::vector<std::size_t> keywordOffsets;
+  thread_local std::vector<std::uint32_t> requestSlots;
+  batchKeywords.reset();
+  keywordOffsets.clear();
+  requestSlots.clear();
+  for (std::size_t index : indices) {
+    const Request& request = requests[index];
+    keywordOffsets.push_back(requestSlots.size());
+    if (hasIdAndSize(request))
+      batchKeywords.insertAll(request._keywords, requestSlots);
   }
-  transaction.matchAds(adVector);
-  if (diagnostics)
-    transaction.printDiagnostics();
-  else {
-    if (transaction._noMatch)
-      _output << transaction._id << ' ' << EMPTY_REPLY;
-    else
-      transaction.printSummary();
+  keywordOffsets.push_back(requestSlots.size());
+  const SizeBucket& bucket = catalog.getBucket(requests[indices.front()]._sizeId);
+  _bloomStatistics.addFalsePositives(batchKeywords.join(catalog, bucket));
+  std::size_t shortCircuits = 0;
+  for (std::size_t i = 0; i < indices.size(); ++i) {
+    const Request& request = requests[indices[i]];
+    if (request._sizeKey == ZERO_SIZE || request._input.empty()) {
+      response.store(worker, indices[i], processRequest(request, catalog, false));
+      continue;
+    }
+    const AdBid* winningBid = nullptr;
+    bool resolved = false;
+    for (std::size_t pos = keywordOffsets[i]; pos < keywordOffsets[i + 1]; ++pos) {
+      std::uint32_t slot = requestSlots[pos];
+      resolved = resolved || batchKeywords.isResolved(slot);
+      if (const AdBid* bid = batchKeywords.getBid(slot); isBetter(bid, winningBid))
+	winningBid = bid;
+    }
+    if (!resolved && keywordOffsets[i + 1] > keywordOffsets[i])
+      ++shortCircuits;
+    _output.clear();
+    printReply(getId(request._input), winningBid, catalog);
+    response.store(worker, indices[i], _output);
   }
+  _bloomStatistics.addShortCircuits(shortCircuits);
+}
+
+// request has the same size and keywords as original and
+// reply is the reply to original, only the id is different.
+
+std::string_view Transaction::copyReply(const Request& request,
+					const Request& original,
+					std::string_view reply) noexcept {
+  std::string_view originalId = getId(original._input);
+  if (!reply.starts_with(originalId))
+    return reply;
+  _output.clear();
+  _output << getId(request._input);
+  _output.append(reply.substr(originalId.size()));
   return _output;
 }
 
-SIZETUPLE Transaction::createSizeKey(std::string_view request) {
+// The size and the keywords are found in one pass by the
+// parser of the batch format, the keywords are split by
+// the transaction.
+
+void Transaction::scanRequest(Request& request, REQUESTFORMAT format) {
+  RequestFields fields = RequestScanner::scan(request._input, format);
+  request._keywords = fields._keywords;
   if (ServerOptions::_useRegex)
-    return createSizeKeyRegExpr(request);
-  auto begPos = request.find(SIZE_START_REG);
-  if (begPos == std::string_view::npos) {
-    if ((begPos = request.find(SIZE_START_ALT)) == std::string_view::npos)
-      return ZERO_SIZE;
-  }
-  request.remove_prefix(begPos);
+    request._sizeKey = createSizeKeyRegExpr(request._input);
+  else
+    request._sizeKey = createSizeKey(fields._size);
+}
+
+// request starts with "size=" or "ad_width=", empty if none
+
+SIZETUPLE Transaction::createSizeKey(std::string_view request) {
+  if (request.empty())
+    return ZERO_SIZE;
   removeNonDigits(request);
   unsigned width;
   auto result = std::from_chars(request.data(), request.data() + request.size(), width);
@@ -151,87 +319,133 @@ SIZETUPLE Transaction::createSizeKey(std::string_view request) {
   return { width, height };
 }
 
+// Patterns are tried in the configured order, the
+// first one matching anywhere in the request wins.
+
 SIZETUPLE Transaction::createSizeKeyRegExpr(std::string_view request) {
-  std::string matched;
-  static const boost::regex regexReg("size=\\d+x\\d+");
-  static const boost::regex regexAlt("ad_width=\\d+&ad_height=\\d+");
-  std::string strToSearch(request);
-  if (boost::smatch match; boost::regex_search(strToSearch, match, regexReg))
-    matched = match.str();
-  else if (boost::smatch match; boost::regex_search(strToSearch, match, regexAlt))
-    matched = match.str();
-  std::string_view view = matched;
-  removeNonDigits(view);
-  unsigned width;
-  auto result = std::from_chars(view.data(), view.data() + view.size(), width);
-  if (result.ec != std::errc())
-    throw std::runtime_error(ioutility::createErrorString(result.ec));
-  view.remove_prefix(result.ptr - view.data());
-  removeNonDigits(view);
-  unsigned height;
-  result = std::from_chars(view.data(), view.data() + view.size(), height);
-  if (result.ec != std::errc())
-    throw std::runtime_error(ioutility::createErrorString(result.ec));
-  return { width, height };    
+  SIZETUPLE sizeKey;
+  for (const SizePattern& pattern : _sizePatterns)
+    if (pattern.search(request, sizeKey))
+      return sizeKey;
+  return ZERO_SIZE;
+}
+
+// Called at startup, throws std::invalid_argument
+// if a pattern is not supported.
+
+void Transaction::setSizePatterns(const std::vector<std::string>& patterns) {
+  if (patterns.empty())
+    return;
+  std::vector<SizePattern> sizePatterns;
+  for (std::string_view pattern : patterns)
+    sizePatterns.emplace_back(pattern);
+  _sizePatterns = std::move(sizePatterns);
 }
 
 const AdBid* Transaction::findWinningBid() const {
   int index = 0;
-  int max = _bids[0]._money;
+  std::int64_t max = _catalog.getBid(_bids[0])._money;
   for (unsigned i = 1; i < _bids.size(); ++i) {
-    int money = _bids[i]._money;
-    if (money > max) {
-      max = money;
+    std::int64_t cents = _catalog.getBid(_bids[i])._money;
+    if (cents > max) {
+      max = cents;
       index = i;
     }
   }
-  return &_bids[index];
+  return &_catalog.getBid(_bids[index]);
 }
 
-struct Comparator {
-  bool operator()(std::string_view keyword, const AdBid& bid) const {
-    return keyword < bid._keyword;
-  }
-
-  bool operator()(const AdBid& bid, std::string_view keyword) const {
-    return bid._keyword < keyword;
-  }
-};
+// Only postings of the request keywords are visited, the cost
+// depends on the number of matches rather than on the bucket size.
+// Postings of different keywords interleave, sorting bid indices
+// restores the order of the ads in the bucket and of the bids in
+// the ad.
 
-void Transaction::matchAds(const std::vector<AdPtr>& adVector) {
-  for (const AdPtr& ad : adVector) {
-    const auto& inputBids = ad->getBids();
-    std::set_intersection(inputBids.cbegin(), inputBids.cend(),
-			  _keywords.cbegin(), _keywords.cend(),
-			  std::back_inserter(_bids),
-			  Comparator());
+void Transaction::matchAds(const SizeBucket& bucket) {
+  for (KeywordId keywordId : _keywordIds) {
+    auto postings = _catalog.getPostings(bucket, keywordId);
+    if (postings.empty())
+      _bloomStatistics.addFalsePositives(1);
+    _bids.insert(_bids.end(), postings.begin(), postings.end());
   }
   if (_bids.empty())
     _noMatch = true;
   else {
+    std::sort(_bids.begin(), _bids.end());
     // replaced std::max_element()
     _winningBid = findWinningBid();
   }
 }
 
+// The winner only path, the full list of matches is not built.
+// The best bid for every keyword is precomputed, ties between
+// keywords go to the bid which is first in the ad order, the
+// same result as in findWinningBid() over all matches.
+
+void Transaction::matchBestBid(const SizeBucket& bucket) {
+  for (KeywordId keywordId : _keywordIds) {
+    const AdBid* bid = _catalog.getBestBid(bucket, keywordId);
+    if (bid == nullptr) {
+      _bloomStatistics.addFalsePositives(1);
+      continue;
+    }
+    if (isBetter(bid, _winningBid))
+      _winningBid = bid;
+  }
+  _noMatch = _winningBid == nullptr;
+}
+
 void Transaction::breakKeywords(std::string_view kwStr) {
   utility::split(kwStr, _keywords, KEYWORD_SEP);
-  std::sort(_keywords.begin(), _keywords.end());
 }
 
-// format1 - kw=toy+longshoremen+recognize+jesbasementsystems+500loans, & - ending
-// format2 - keywords=cars+mazda, & - ending
-bool Transaction::parseKeywords(std::string_view start) {
-  auto beg = _request.find(start);
-  if (beg == std::string_view::npos)
-    return false;
-  auto keyWordsbeg = std::next(_request.cbegin(), beg + start.size());
-  auto end = _request.find(KEYWORDS_END, beg);
-  auto keyWordsEnd = end == std::string_view::npos ?
-    _request.cend() : std::next(_request.cbegin(), end);
-  std::string_view kwStr(keyWordsbeg, keyWordsEnd);
-  breakKeywords(kwStr);
-  return true;
+// Keywords rejected by the Bloom filter of the size or unknown
+// to the ads can not match and are dropped here. If none is left
+// the request is answered without touching the index.
+
+void Transaction::resolveKeywords(const SizeBucket& bucket) {
+  for (std::string_view keyword : _keywords) {
+    std::uint64_t hash = catalogimage::hashString(keyword);
+    if (!_catalog.mayContain(bucket, hash))
+      continue;
+    KeywordId keywordId = _catalog.getDictionary().find(keyword, hash);
+    if (keywordId != UNKNOWN_KEYWORD)
+      _keywordIds.push_back(keywordId);
+    else
+      _bloomStatistics.addFalsePositives(1);
+  }
+  if (_keywordIds.empty()) {
+    _noMatch = true;
+    if (!_keywords.empty())
+      _bloomStatistics.addShortCircuits(1);
+    return;
+  }
+  std::sort(_keywordIds.begin(), _keywordIds.end());
+  _keywordIds.erase(std::unique(_keywordIds.begin(), _keywordIds.end()), _keywordIds.end());
+}
+
+Transaction::BloomStatistics::BloomStatistics() {
+  std::lock_guard lock(_bloomMutex);
+  _bloomThreads.push_back(this);
+}
+
+Transaction::BloomStatistics::~BloomStatistics() {
+  std::lock_guard lock(_bloomMutex);
+  _bloomRetiredShortCircuits += _shortCircuits;
+  _bloomRetiredFalsePositives += _falsePositives;
+  std::erase(_bloomThreads, this);
+}
+
+void Transaction::printStatistics() {
+  std::lock_guard lock(_bloomMutex);
+  std::size_t shortCircuits = _bloomRetiredShortCircuits;
+  std::size_t falsePositives = _bloomRetiredFalsePositives;
+  for (const BloomStatistics* statistics : _bloomThreads) {
+    shortCircuits += statistics->_shortCircuits;
+    falsePositives += statistics->_falsePositives;
+  }
+  Info << "requests answered by Bloom filter:" << shortCircuits
+       << " false positive keywords:" << falsePositives << '\n';
 }
 
 // Replacement for ostream operators to reduce number of
@@ -250,34 +464,51 @@ void Transaction::printDiagnostics() const {
     printWinningAd();
 }
 
-void Transaction::printSummary() const {
-  _output << _id << ' ';
-  double money = _winningBid->_money / Ad::_scaler;
-  if (auto ad = _winningBid->_ad.lock())
-  _output << ad->getId() << DELIMITER << money << '\n';
+// The highest bid wins, the first one in the ad order if
+// there are several. bid may be nullptr.
+
+bool Transaction::isBetter(const AdBid* bid, const AdBid* winningBid) {
+  if (bid == nullptr)
+    return false;
+  return winningBid == nullptr || bid->_money > winningBid->_money ||
+    (bid->_money == winningBid->_money && bid < winningBid);
+}
+
+// winningBid is nullptr if there is no match
+
+void Transaction::printReply(std::string_view id, const AdBid* winningBid, const AdCatalog& catalog) {
+  _output << id << ' ';
+  if (winningBid == nullptr) {
+    _output << EMPTY_REPLY;
+    return;
+  }
+  _output << catalog.getId(winningBid->_adIndex) << DELIMITER;
+  money::print(winningBid->_money, _output);
+  _output << '\n';
 }
 
 void Transaction::printMatchingAds() const {
   _output << MATCHINGADS;
-  for (const AdBid& adBid : _bids) {
-    if (auto ad = adBid._ad.lock())
-      ad->print(_output);
-    _output << MATCH << adBid._keyword << ' ' << adBid._money << '\n';
+  for (BidIndex bidIndex : _bids) {
+    const AdBid& adBid = _catalog.getBid(bidIndex);
+    _catalog.print(adBid._adIndex, _output);
+    _output << MATCH << _catalog.getKeyword(adBid._keywordId) << ' ' << adBid._money << '\n';
   }
 }
 
 void Transaction::printWinningAd() const {
-  if (auto ad = _winningBid->_ad.lock())
-    _output << ad->getId() << DELIMITER
-	    << _winningBid->_keyword << DELIMITER;
-  double money = _winningBid->_money / Ad::_scaler;
-  _output << money << ENDING;
+  _output << _catalog.getId(_winningBid->_adIndex) << DELIMITER
+	  << _catalog.getKeyword(_winningBid->_keywordId) << DELIMITER;
+  money::print(_winningBid->_money, _output);
+  _output << ENDING;
 }
 
 void Transaction::printRequestData() const {
   _output << _id << ' ';
   _output << TRANSACTIONSIZE << _sizeKey;
   _output << MATCHES << _bids.size() << '\n' << _request << REQUESTKEYWORDS;
+  // only diagnostics needs keyword strings in order
+  std::sort(_keywords.begin(), _keywords.end());
   for (std::string_view keyword : _keywords)
     _output << ' ' << keyword << '\n';
 }
@@ -285,5 +516,6 @@ void Transaction::printRequestData() const {
 void Transaction::clear() {
   _bids.clear();
   _keywords.clear();
+  _keywordIds.clear();
   _output.clear();
 }
@@ -4,39 +4,60 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <span>
+#include <string>
 #include <tuple>
 #include <vector>
 
 #include <boost/core/noncopyable.hpp>
 
+#include "AdBid.h"
 #include "Task.h"
 
-struct AdBid;
+class AdCatalog;
+class SizePattern;
+namespace catalogimage { struct SizeBucket; }
+using SizeBucket = catalogimage::SizeBucket;
 using SIZETUPLE = std::tuple<unsigned, unsigned>;
-using AdPtr = std::shared_ptr<class Ad>;
 
 constexpr SIZETUPLE ZERO_SIZE;
 
 class Transaction : private boost::noncopyable {
 public:
-  static std::string_view processRequestSort(const SIZETUPLE& sizeKey,
-					     const Request& request,
-					     bool diagnostics) noexcept;
-
-  static std::string_view processRequestNoSort(const Request& request,
-					       bool diagnostics) noexcept;
+  static std::string_view processRequest(const Request& request,
+					  const AdCatalog& catalog,
+					  bool diagnostics) noexcept;
+  static void processBatch(const std::vector<Request>& requests,
+			   std::span<const std::size_t> indices,
+			   const AdCatalog& catalog,
+			   Response& response,
+			   unsigned worker) noexcept;
+  static std::string_view copyReply(const Request& request,
+				     const Request& original,
+				     std::string_view reply) noexcept;
+  // only such requests share replies and batch keywords
+  static bool hasIdAndSize(const Request& request) {
+    return request._sizeKey != ZERO_SIZE && !getId(request._input).empty();
+  }
   ~Transaction() = default;
-  static SIZETUPLE createSizeKey(std::string_view request);
+  static void scanRequest(Request& request, REQUESTFORMAT format);
+  static void setSizePatterns(const std::vector<std::string>& patterns);
+  static void printStatistics();
 private:
-  explicit Transaction(const Request& request);
-  Transaction(const SIZETUPLE& sizeKey, const Request& request);
-  void init(std::string_view input);
+  Transaction(const AdCatalog& catalog, const Request& request);
+  void init(const Request& request);
+  static std::string_view getId(std::string_view input);
+  static SIZETUPLE createSizeKey(std::string_view request);
   static SIZETUPLE createSizeKeyRegExpr(std::string_view request);
   void breakKeywords(std::string_view kwStr);
-  bool parseKeywords(std::string_view start);
-  void matchAds(const std::vector<AdPtr>& adVector);
-  void printSummary() const;
+  void resolveKeywords(const SizeBucket& bucket);
+  void matchAds(const SizeBucket& bucket);
+  void matchBestBid(const SizeBucket& bucket);
+  static void printReply(std::string_view id, const AdBid* winningBid, const AdCatalog& catalog);
+  static bool isBetter(const AdBid* bid, const AdBid* winningBid);
   void printDiagnostics() const;
   const AdBid* findWinningBid() const;
   void printRequestData() const;
@@ -45,13 +66,39 @@ private:
   void clear();
   std::string_view _id;
   std::string_view _request;
-  // Next 3 made static thread_local to reuse allocated memory.
+  // Next 4 made static thread_local to reuse allocated memory.
   // Every transaction clears these objects, but keeps capacity
   // for further usage. Valgrind shows server number of
   // allocations reduced by a factor of 10.
-  static thread_local std::vector<AdBid> _bids;
+  static thread_local std::vector<BidIndex> _bids;
   static thread_local std::vector<std::string_view> _keywords;
+  static thread_local std::vector<KeywordId> _keywordIds;
   static thread_local std::string _output;
+  // requests with no keyword passing the Bloom filter and
+  // keywords passing it without a match, to size the filter.
+  // Every thread counts in its own object, the objects are
+  // summed by printStatistics, counts of finished threads
+  // are kept in _bloomRetired.
+  struct alignas(64) BloomStatistics {
+    BloomStatistics();
+    ~BloomStatistics();
+    void addShortCircuits(std::size_t number) {
+      _shortCircuits.store(_shortCircuits.load(std::memory_order_relaxed) + number, std::memory_order_relaxed);
+    }
+    void addFalsePositives(std::size_t number) {
+      _falsePositives.store(_falsePositives.load(std::memory_order_relaxed) + number, std::memory_order_relaxed);
+    }
+    std::atomic<std::size_t> _shortCircuits = 0;
+    std::atomic<std::size_t> _falsePositives = 0;
+  };
+  static thread_local BloomStatistics _bloomStatistics;
+  static std::mutex _bloomMutex;
+  static std::vector<const BloomStatistics*> _bloomThreads;
+  static std::size_t _bloomRetiredShortCircuits;
+  static std::size_t _bloomRetiredFalsePositives;
+  // "UseRegex" size patterns
+  static std::vector<SizePattern> _sizePatterns;
+  const AdCatalog& _catalog;
   const SIZETUPLE _sizeKey;
   const AdBid* _winningBid = nullptr;
   bool _noMatch{ false };
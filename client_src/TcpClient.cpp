@@ -59,12 +59,17 @@ bool TcpClient::receive() {
 	Warn << ec.what() << '\n';
       return false;
     }
+    // a reply with diagnostics may come in several frames
     HEADER header;
     std::array<std::reference_wrapper<std::string>, 1> array{ std::ref(_response) };
-    if (!Tcp::readMessage(_socket, header, array))
-      return false;
-    _status = STATUS::NONE;
-    return printReply();
+    do {
+      if (!Tcp::readFrame(_socket, _frames, header, array))
+	return false;
+      _status = STATUS::NONE;
+      if (!printReply())
+	return false;
+    } while (extractStatus(header) == STATUS::SUBTASK_DONE);
+    return true;
   }
   catch (const std::exception& e) {
     Warn << e.what() << '\n';
@@ -20,6 +20,8 @@ class TcpClient : public Client {
   void sendSignature();
   boost::asio::io_context _ioContext;
   boost::asio::ip::tcp::socket _socket;
+  // read ahead bytes of the next frame of a reply
+  std::string _frames;
  public:
   TcpClient();
   ~TcpClient() override = default;
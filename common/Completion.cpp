@@ -0,0 +1,41 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include "Completion.h"
+
+#include <thread>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+enum : std::uint32_t { PENDING, DONE, SLEEPING };
+
+} // end of anonymous namespace
+
+void Completion::reset() {
+  _done.store(PENDING, std::memory_order_relaxed);
+}
+
+// The futex is woken only if the owner sleeps.
+
+void Completion::signal() {
+  if (_done.exchange(DONE, std::memory_order_release) == SLEEPING)
+    syscall(SYS_futex, &_done, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+void Completion::wait(unsigned spinCount) {
+  for (unsigned i = 0; i < spinCount; ++i) {
+    if (isDone())
+      return;
+    std::this_thread::yield();
+  }
+  std::uint32_t state = PENDING;
+  if (!_done.compare_exchange_strong(state, SLEEPING, std::memory_order_acquire) && state == DONE)
+    return;
+  while (_done.load(std::memory_order_acquire) != DONE)
+    syscall(SYS_futex, &_done, FUTEX_WAIT_PRIVATE, SLEEPING, nullptr, nullptr, 0);
+}
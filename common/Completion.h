@@ -0,0 +1,27 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <boost/core/noncopyable.hpp>
+
+// End of a task signaled to the thread waiting for it, reused
+// for every task without allocation. The owner checks spinCount
+// times before it sleeps on a futex. reset is called before the
+// task is queued.
+
+class Completion : private boost::noncopyable {
+  // PENDING, DONE or SLEEPING, 32 bits for the futex
+  std::atomic<std::uint32_t> _done = 0;
+ public:
+  Completion() = default;
+  ~Completion() = default;
+  void reset();
+  void signal();
+  void wait(unsigned spinCount = 0);
+  bool isDone() const { return _done.load(std::memory_order_acquire) != 0; }
+};
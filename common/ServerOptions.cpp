@@ -4,6 +4,7 @@
 
 #include "ServerOptions.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <thread>
 
@@ -15,13 +16,24 @@ COMPRESSORS ServerOptions::_compressor;
 int ServerOptions::_compressionLevel;
 bool ServerOptions::_doEncrypt;
 int ServerOptions::_numberWorkThreads;
+bool ServerOptions::_workStealing;
+std::size_t ServerOptions::_sliceSize;
+std::size_t ServerOptions::_tcpSessionWeight;
+std::size_t ServerOptions::_fifoSessionWeight;
+std::size_t ServerOptions::_coalesceRequests;
+int ServerOptions::_coalesceWindow;
+unsigned ServerOptions::_completionSpinCount;
 int ServerOptions::_maxTcpSessions;
 int ServerOptions::_maxFifoSessions;
 int ServerOptions::_maxTotalSessions;
 int ServerOptions::_tcpTimeout;
 bool ServerOptions::_useRegex;
+std::vector<std::string> ServerOptions::_sizePatterns;
 POLICYENUM ServerOptions::_policyEnum;
 std::size_t ServerOptions::_bufferSize;
+int ServerOptions::_diagnosticsSampling;
+std::size_t ServerOptions::_diagnosticsMaxRequests;
+std::size_t ServerOptions::_diagnosticsFrameSize;
 bool ServerOptions::_timing;
 bool ServerOptions::_printHeader;
 boost::static_string<100> ServerOptions::_logThresholdName;
@@ -43,13 +55,26 @@ void ServerOptions::parse(std::string_view jsonName) {
     _doEncrypt = _jvS.at("doEncrypt").as_bool();
     int numberWorkThreadsCfg = _jvS.at("NumberWorkThreads").as_int64();
     _numberWorkThreads = numberWorkThreadsCfg ? numberWorkThreadsCfg : std::thread::hardware_concurrency();
+    _workStealing = _jvS.at("WorkStealing").as_bool();
+    _sliceSize = _jvS.at("SliceSize").as_int64();
+    _tcpSessionWeight = std::max<std::size_t>(_jvS.at("TcpSessionWeight").as_int64(), 1);
+    _fifoSessionWeight = std::max<std::size_t>(_jvS.at("FifoSessionWeight").as_int64(), 1);
+    _coalesceRequests = _jvS.at("CoalesceRequests").as_int64();
+    _coalesceWindow = _jvS.at("CoalesceWindow").as_int64();
+    _completionSpinCount = _jvS.at("CompletionSpinCount").as_int64();
     _maxTcpSessions = _jvS.at("MaxTcpSessions").as_int64();
     _maxFifoSessions = _jvS.at("MaxFifoSessions").as_int64();
     _maxTotalSessions = _jvS.at("MaxTotalSessions").as_int64();
     _tcpTimeout = _jvS.at("TcpTimeout").as_int64();
     _useRegex = _jvS.at("UseRegex").as_bool();
+    _sizePatterns.clear();
+    for (const boost::json::value& pattern : _jvS.at("SizePatterns").as_array())
+      _sizePatterns.emplace_back(pattern.as_string());
     _policyEnum = fromString(_jvS.at("Policy").as_string());
     _bufferSize = _jvS.at("BufferSize").as_int64();
+    _diagnosticsSampling = std::max<int>(_jvS.at("DiagnosticsSampling").as_int64(), 1);
+    _diagnosticsMaxRequests = _jvS.at("DiagnosticsMaxRequests").as_int64();
+    _diagnosticsFrameSize = _jvS.at("DiagnosticsFrameSize").as_int64();
     _timing = _jvS.at("Timing").as_bool();
     _printHeader = _jvS.at("PrintHeader").as_bool();
     _logThresholdName = _jvS.at("LogThreshold").as_string();
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "Options.h"
 #include "Policy.h"
 
@@ -14,13 +17,24 @@ struct ServerOptions : Options {
   static int _compressionLevel;
   static bool _doEncrypt;
   static int _numberWorkThreads;
+  static bool _workStealing;
+  static std::size_t _sliceSize;
+  static std::size_t _tcpSessionWeight;
+  static std::size_t _fifoSessionWeight;
+  static std::size_t _coalesceRequests;
+  static int _coalesceWindow;
+  static unsigned _completionSpinCount;
   static int _maxTcpSessions;
   static int _maxFifoSessions;
   static int _maxTotalSessions;
   static int _tcpTimeout;
   static bool _useRegex;
+  static std::vector<std::string> _sizePatterns;
   static POLICYENUM _policyEnum;
   static std::size_t _bufferSize;
+  static int _diagnosticsSampling;
+  static std::size_t _diagnosticsMaxRequests;
+  static std::size_t _diagnosticsFrameSize;
   static bool _timing;
   static bool _printHeader;
   static boost::static_string<100> _logThresholdName;
@@ -85,4 +85,21 @@ bool Tcp::readMessage(boost::asio::ip::tcp::socket& socket,
   return ioutility::processMessage(_payload, header, array);
 }
 
+bool Tcp::readFrame(boost::asio::ip::tcp::socket& socket,
+		    std::string& buffer,
+		    HEADER& header,
+		    std::span<std::reference_wrapper<std::string>> array) {
+  boost::system::error_code ec;
+  std::size_t size = boost::asio::read_until(socket,
+    boost::asio::dynamic_buffer(buffer), ENDOFMESSAGE, ec);
+  if (ec) {
+    Info << ec.what() << '\n';
+    return false;
+  }
+  bool result =
+    ioutility::processMessage(std::string_view(buffer).substr(0, size - ENDOFMESSAGESZ), header, array);
+  buffer.erase(0, size);
+  return result;
+}
+
 } // end of namespace tcp
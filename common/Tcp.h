@@ -60,6 +60,13 @@ public:
   static bool readMessage(boost::asio::ip::tcp::socket& socket,
 			  HEADER& header,
 			  std::span<std::reference_wrapper<std::string>> array);
+
+  // Reads one of the messages sent one after another, buffer
+  // keeps the bytes of the next message read with this one.
+  static bool readFrame(boost::asio::ip::tcp::socket& socket,
+			std::string& buffer,
+			HEADER& header,
+			std::span<std::reference_wrapper<std::string>> array);
 };
 
 } // end of namespace tcp
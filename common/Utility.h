@@ -4,11 +4,14 @@
 
 #pragma once
 
+#include <algorithm>
 #include <deque>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <string_view>
+#include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/asio/posix/stream_descriptor.hpp>
@@ -93,6 +96,41 @@ void split(const INPUT& input, CONTAINER& rows, const char* separators) {
   }
 }
 
+// Chunks of about equal size ending with a complete line,
+// at most maxChunks and at least minChunkSize bytes unless
+// there is one chunk. CONTAINER is reused.
+
+template <typename CONTAINER>
+void splitChunks(std::string_view text,
+		 std::size_t maxChunks,
+		 std::size_t minChunkSize,
+		 CONTAINER& chunks) {
+  chunks.clear();
+  std::size_t numberChunks = std::clamp<std::size_t>(text.size() / minChunkSize, 1, std::max<std::size_t>(1, maxChunks));
+  std::size_t chunkSize = text.size() / numberChunks + 1;
+  while (!text.empty()) {
+    std::size_t end = text.find('\n', std::min(chunkSize, text.size()) - 1);
+    end = end == std::string_view::npos ? text.size() : end + 1;
+    chunks.emplace_back(text.substr(0, end));
+    text.remove_prefix(end);
+  }
+}
+
+// Runs func(chunk) for every chunk, chunk 0 in the calling
+// thread, and rethrows the first exception.
+
+template <typename FUNC>
+void runParallel(std::size_t numberChunks, FUNC func) {
+  if (numberChunks == 0)
+    return;
+  std::vector<std::future<void>> futures;
+  for (std::size_t chunk = 1; chunk < numberChunks; ++chunk)
+    futures.push_back(std::async(std::launch::async, func, chunk));
+  func(0);
+  for (auto& future : futures)
+    future.get();
+}
+
 template <typename BUFFER>
 void readFile(std::string_view fileName, BUFFER& buffer) {
   std::ifstream stream;
@@ -0,0 +1,21 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include "BatchJoinPolicy.h"
+
+#include "Transaction.h"
+
+std::string_view BatchJoinPolicy::operator() (const Request& request,
+					      const AdCatalogPtr& catalog,
+					      bool diagnostics) {
+  return Transaction::processRequest(request, *catalog, diagnostics);
+}
+
+void BatchJoinPolicy::processBatch(const std::vector<Request>& requests,
+				   std::span<const std::size_t> indices,
+				   const AdCatalogPtr& catalog,
+				   Response& response,
+				   unsigned worker) {
+  Transaction::processBatch(requests, indices, *catalog, response, worker);
+}
@@ -0,0 +1,25 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#pragma once
+
+#include "Policy.h"
+
+// SORTINPUT order, the requests of one size are
+// matched with the ads of the size at once.
+
+class BatchJoinPolicy : public Policy {
+ public:
+  BatchJoinPolicy() = default;
+
+  ~BatchJoinPolicy() override = default;
+
+  std::string_view operator() (const Request&, const AdCatalogPtr&, bool) override;
+
+  void processBatch(const std::vector<Request>& requests,
+		    std::span<const std::size_t> indices,
+		    const AdCatalogPtr& catalog,
+		    Response& response,
+		    unsigned worker) override;
+};
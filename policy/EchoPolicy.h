@@ -14,5 +14,5 @@ class EchoPolicy : public Policy {
 
   static thread_local std::string _buffer;
 
-  std::string_view operator() (const Request&, bool) override;
+  std::string_view operator() (const Request&, const AdCatalogPtr&, bool) override;
 };
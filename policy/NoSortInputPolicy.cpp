@@ -7,6 +7,7 @@
 #include "Transaction.h"
 
 std::string_view NoSortInputPolicy::operator() (const Request& request,
+						const AdCatalogPtr& catalog,
 						bool diagnostics) {
-  return Transaction::processRequestNoSort(request, diagnostics);
+  return Transaction::processRequest(request, *catalog, diagnostics);
 }
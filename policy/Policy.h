@@ -4,11 +4,16 @@
 
 #pragma once
 
+#include <span>
+
 #include "Task.h"
 
+using AdCatalogPtr = std::shared_ptr<const class AdCatalog>;
+
 enum class POLICYENUM {
   SORTINPUT,
   NOSORTINPUT,
+  BATCHJOIN,
   ECHOPOLICY,
   NONE
 };
@@ -18,6 +23,8 @@ enum class POLICYENUM {
     return POLICYENUM::SORTINPUT;
   else if (name == "NOSORTINPUT")
     return POLICYENUM::NOSORTINPUT;
+  else if (name == "BATCHJOIN")
+    return POLICYENUM::BATCHJOIN;
   else if (name == "ECHO")
     return POLICYENUM::ECHOPOLICY;
   return POLICYENUM::NONE;
@@ -29,6 +36,8 @@ enum class POLICYENUM {
     return "SORTINPUT";
   case POLICYENUM::NOSORTINPUT:
     return "NOSORTINPUT";
+  case POLICYENUM::BATCHJOIN:
+    return "BATCHJOIN";
   case POLICYENUM::ECHOPOLICY:
     return "ECHO";
   default:
@@ -46,6 +55,19 @@ public:
 
   virtual ~Policy() = default;
 
-  virtual std::string_view operator() (const Request&, bool) = 0;
+  virtual std::string_view operator() (const Request&, const AdCatalogPtr&, bool) = 0;
+
+  // Requests of one size answered together, the reply to
+  // requests[index] is stored for index in the arena of the
+  // worker. Only policies joining a batch with the ads
+  // override it.
+  virtual void processBatch(const std::vector<Request>& requests,
+			    std::span<const std::size_t> indices,
+			    const AdCatalogPtr& catalog,
+			    Response& response,
+			    unsigned worker) {
+    for (std::size_t index : indices)
+      response.store(worker, index, (*this)(requests[index], catalog, false));
+  }
 
 };
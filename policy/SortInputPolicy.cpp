@@ -7,6 +7,7 @@
 #include "Transaction.h"
 
 std::string_view SortInputPolicy::operator() (const Request& request,
+					      const AdCatalogPtr& catalog,
 					      bool diagnostics) {
-  return Transaction::processRequestSort(request._sizeKey, request, diagnostics);
+  return Transaction::processRequest(request, *catalog, diagnostics);
 }
@@ -12,5 +12,5 @@ class SortInputPolicy : public Policy {
   
   ~SortInputPolicy() override = default;
 
-  std::string_view operator() (const Request&, bool) override;
+  std::string_view operator() (const Request&, const AdCatalogPtr&, bool) override;
 };
@@ -0,0 +1,86 @@
+/*
+*  Copyright (C) 2021 Ilya Entin
+*/
+
+#include <filesystem>
+#include <fstream>
+
+#include "AdCatalog.h"
+#include "Task.h"
+#include "TestEnvironment.h"
+
+// the compiled image must be equivalent to the catalog built from text
+
+TEST(AdCatalogTest, CompiledImage) {
+  const std::string imageFile = "build/adsTest.bin";
+  AdCatalog::compile("data/ads.txt", imageFile);
+  AdCatalog text("data/ads.txt");
+  AdCatalog image(imageFile);
+  ASSERT_FALSE(text.isMapped());
+  ASSERT_TRUE(image.isMapped());
+  ASSERT_EQ(text.size(), image.size());
+  ASSERT_EQ(text.getDictionary().size(), image.getDictionary().size());
+  std::string textOutput;
+  std::string imageOutput;
+  for (AdIndex index = 0; index < text.size(); ++index) {
+    text.print(index, textOutput);
+    image.print(index, imageOutput);
+  }
+  ASSERT_EQ(textOutput, imageOutput);
+  for (KeywordId id = 0; id < image.getDictionary().size(); ++id)
+    ASSERT_EQ(image.getDictionary().find(image.getKeyword(id)), id);
+  ASSERT_EQ(image.getDictionary().find("no such keyword"), UNKNOWN_KEYWORD);
+  std::filesystem::remove(imageFile);
+}
+
+TEST(AdCatalogTest, RejectCorruptedImage) {
+  const std::string imageFile = "build/adsTest.bin";
+  AdCatalog::compile("data/ads.txt", imageFile);
+  std::filesystem::resize_file(imageFile, 1000);
+  ASSERT_THROW(AdCatalog catalog(imageFile), std::runtime_error);
+  std::filesystem::remove(imageFile);
+}
+
+// an ad with a wrong bid is skipped with its keywords
+
+TEST(AdCatalogTest, SkipMalformedBid) {
+  const std::string textFile = "build/adsMalformed.txt";
+  std::ofstream(textFile) <<
+    "1, 300, 250, 1.0, [\"alpha\", 1.0, \"beta\", 2.0]\n"
+    "2, 300, 250, 1.0, [\"gamma\", 1.0, \"delta\", x]\n"
+    "3, 728, 90, 1.0, [\"alpha\", 0.5]\n";
+  AdCatalog catalog(textFile);
+  ASSERT_EQ(catalog.size(), 2);
+  ASSERT_EQ(catalog.getId(0), "1");
+  ASSERT_EQ(catalog.getId(1), "3");
+  ASSERT_EQ(catalog.getDictionary().size(), 2);
+  ASSERT_EQ(catalog.getDictionary().find("gamma"), UNKNOWN_KEYWORD);
+  ASSERT_EQ(catalog.getDictionary().find("delta"), UNKNOWN_KEYWORD);
+  KeywordId alpha = catalog.getDictionary().find("alpha");
+  ASSERT_NE(alpha, UNKNOWN_KEYWORD);
+  const SizeBucket& bucket = catalog.getBucket(SIZETUPLE{ 300, 250 });
+  ASSERT_NE(catalog.getBestBid(bucket, alpha), nullptr);
+  ASSERT_EQ(catalog.getPostings(bucket, alpha).size(), 1);
+  std::filesystem::remove(textFile);
+}
+
+// a task keeps the catalog it started with after a reload
+
+TEST(AdCatalogTest, ReloadKeepsSnapshot) {
+  AdCatalog::create("data/ads.txt");
+  std::weak_ptr<const AdCatalog> old = AdCatalog::get();
+  std::string batch("[0]size=300x250&kw=disk\n");
+  HEADER header{ HEADERTYPE::SESSION, batch.size(), 0, COMPRESSORS::NONE,
+		 DIAGNOSTICS::NONE, STATUS::NONE, 0, 0 };
+  Task task;
+  task.update(header, batch);
+  AdCatalog::create("data/ads.txt");
+  AdCatalogPtr current = AdCatalog::get();
+  ASSERT_FALSE(old.expired());
+  ASSERT_NE(old.lock(), current);
+  ASSERT_NE(old.lock()->getGeneration(), current->getGeneration());
+  ASSERT_EQ(task.getNumberRequests(), 1);
+  task.releaseCatalog();
+  ASSERT_TRUE(old.expired());
+  AdCatalog::destroy();
+}
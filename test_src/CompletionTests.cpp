@@ -0,0 +1,28 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "Completion.h"
+
+// ./testbin --gtest_filter=CompletionTest*
+
+TEST(CompletionTest, Wait) {
+  Completion completion;
+  for (unsigned spinCount : { 0U, 1000U }) {
+    for (int i = 0; i < 100; ++i) {
+      completion.reset();
+      int result = 0;
+      std::jthread worker([&] {
+	result = i;
+	completion.signal();
+      });
+      completion.wait(spinCount);
+      EXPECT_TRUE(completion.isDone());
+      EXPECT_EQ(result, i);
+    }
+  }
+}
@@ -6,6 +6,7 @@
 #include "FifoClient.h"
 #include "Server.h"
 #include "ServerOptions.h"
+#include "Task.h"
 #include "TcpClient.h"
 #include "TestEnvironment.h"
 
@@ -136,6 +137,90 @@ TEST_F(LogicTest, TCP_LZ4_ZSTD_3600000_NOTENCRYPT_NOTENCRYPT_ND) {
   testLogic(CLIENT_TYPE::TCPCLIENT, COMPRESSORS::LZ4, COMPRESSORS::ZSTD, 3600000, DIAGNOSTICS::NONE);
 }
 
+// the reply with diagnostics is sent in about 50 frames
+TEST_F(LogicTest, TCP_LZ4_ZSTD_3600000_ENCRYPT_ENCRYPT_D_FRAMES) {
+  ServerOptions::_doEncrypt = true;
+  ClientOptions::_doEncrypt = true;
+  ServerOptions::_diagnosticsFrameSize = 100000;
+  testLogic(CLIENT_TYPE::TCPCLIENT, COMPRESSORS::LZ4, COMPRESSORS::ZSTD, 3600000, DIAGNOSTICS::ENABLED);
+}
+
+// schedulers of the TaskController, small batches are split in slices
+
+TEST_F(LogicTest, TCP_LZ4_LZ4_100000_ENCRYPT_ENCRYPT_ND_BARRIER) {
+  ServerOptions::_doEncrypt = true;
+  ClientOptions::_doEncrypt = true;
+  ServerOptions::_workStealing = false;
+  testLogic(CLIENT_TYPE::TCPCLIENT, COMPRESSORS::LZ4, COMPRESSORS::LZ4, 100000, DIAGNOSTICS::NONE);
+}
+
+// batches coalesced in one barrier phase
+
+TEST_F(LogicTest, TCP_LZ4_LZ4_100000_ENCRYPT_ENCRYPT_ND_NOCOALESCE) {
+  ServerOptions::_doEncrypt = true;
+  ClientOptions::_doEncrypt = true;
+  ServerOptions::_workStealing = false;
+  ServerOptions::_coalesceRequests = 0;
+  testLogic(CLIENT_TYPE::TCPCLIENT, COMPRESSORS::LZ4, COMPRESSORS::LZ4, 100000, DIAGNOSTICS::NONE);
+}
+
+TEST_F(LogicTest, TCP_LZ4_LZ4_100000_ENCRYPT_ENCRYPT_D_NOCOALESCE) {
+  ServerOptions::_doEncrypt = true;
+  ClientOptions::_doEncrypt = true;
+  ServerOptions::_workStealing = false;
+  ServerOptions::_coalesceRequests = 0;
+  testLogic(CLIENT_TYPE::TCPCLIENT, COMPRESSORS::LZ4, COMPRESSORS::LZ4, 100000, DIAGNOSTICS::ENABLED);
+}
+
+TEST_F(LogicTest, TCP_LZ4_LZ4_100000_ENCRYPT_ENCRYPT_ND_COALESCE) {
+  ServerOptions::_doEncrypt = true;
+  ClientOptions::_doEncrypt = true;
+  ServerOptions::_workStealing = false;
+  ServerOptions::_coalesceRequests = 1000;
+  testLogic(CLIENT_TYPE::TCPCLIENT, COMPRESSORS::LZ4, COMPRESSORS::LZ4, 100000, DIAGNOSTICS::NONE);
+}
+
+TEST_F(LogicTest, FIFO_LZ4_LZ4_100000_ENCRYPT_ENCRYPT_D_COALESCE) {
+  ServerOptions::_doEncrypt = true;
+  ClientOptions::_doEncrypt = true;
+  ServerOptions::_workStealing = false;
+  ServerOptions::_coalesceRequests = 1000;
+  ServerOptions::_coalesceWindow = 1000;
+  testLogic(CLIENT_TYPE::FIFOCLIENT, COMPRESSORS::LZ4, COMPRESSORS::LZ4, 100000, DIAGNOSTICS::ENABLED);
+}
+
+TEST_F(LogicTest, TCP_LZ4_LZ4_100000_ENCRYPT_ENCRYPT_ND_STEALING) {
+  ServerOptions::_doEncrypt = true;
+  ClientOptions::_doEncrypt = true;
+  ServerOptions::_workStealing = true;
+  ServerOptions::_sliceSize = 0;
+  testLogic(CLIENT_TYPE::TCPCLIENT, COMPRESSORS::LZ4, COMPRESSORS::LZ4, 100000, DIAGNOSTICS::NONE);
+}
+
+TEST_F(LogicTest, TCP_LZ4_LZ4_100000_ENCRYPT_ENCRYPT_D_STEALING) {
+  ServerOptions::_doEncrypt = true;
+  ClientOptions::_doEncrypt = true;
+  ServerOptions::_workStealing = true;
+  ServerOptions::_sliceSize = 0;
+  testLogic(CLIENT_TYPE::TCPCLIENT, COMPRESSORS::LZ4, COMPRESSORS::LZ4, 100000, DIAGNOSTICS::ENABLED);
+}
+
+TEST_F(LogicTest, TCP_LZ4_LZ4_100000_ENCRYPT_ENCRYPT_ND_SLICES) {
+  ServerOptions::_doEncrypt = true;
+  ClientOptions::_doEncrypt = true;
+  ServerOptions::_workStealing = true;
+  ServerOptions::_sliceSize = 64;
+  testLogic(CLIENT_TYPE::TCPCLIENT, COMPRESSORS::LZ4, COMPRESSORS::LZ4, 100000, DIAGNOSTICS::NONE);
+}
+
+TEST_F(LogicTest, FIFO_LZ4_LZ4_100000_ENCRYPT_ENCRYPT_D_SLICES) {
+  ServerOptions::_doEncrypt = true;
+  ClientOptions::_doEncrypt = true;
+  ServerOptions::_workStealing = true;
+  ServerOptions::_sliceSize = 64;
+  testLogic(CLIENT_TYPE::FIFOCLIENT, COMPRESSORS::LZ4, COMPRESSORS::LZ4, 100000, DIAGNOSTICS::ENABLED);
+}
+
 TEST_F(LogicTest, TCP_NONE_NONE_3600000_ENCRYPT_NOTENCRYPT_D) {
   ServerOptions::_doEncrypt = true;
   ClientOptions::_doEncrypt = false;
@@ -257,39 +342,78 @@ TEST_F(LogicTestAltFormat, Diagnostics) {
 }
 
 struct LogicTestSortInput : testing::Test {
-  void testLogicSortInput(bool sort) {
+  void testLogicSortInput(POLICYENUM policy, DIAGNOSTICS diagnostics = DIAGNOSTICS::ENABLED) {
     ServerOptions::_compressor = COMPRESSORS::SNAPPY;
     ServerOptions::_doEncrypt = true;
     ClientOptions::_doEncrypt = true;
     // start server
-    ServerPtr server = ServerPtr();
-    if (sort) {
-      ServerOptions::_policyEnum = POLICYENUM::SORTINPUT;
-      server = std::make_shared<Server>();
-    }
-    else {
-      ServerOptions::_policyEnum = POLICYENUM::NOSORTINPUT;
-      server = std::make_shared<Server>();
-    }
+    ServerOptions::_policyEnum = policy;
+    ServerPtr server = std::make_shared<Server>();
     ASSERT_TRUE(server->start());
     // start client
-    ClientOptions::_diagnostics = DIAGNOSTICS::ENABLED;
+    ClientOptions::_diagnostics = diagnostics;
     tcp::TcpClient client;
     client.run();
-    std::string_view calibratedOutput = TestEnvironment::_outputD;
+    std::string_view calibratedOutput = diagnostics == DIAGNOSTICS::ENABLED ?
+      TestEnvironment::_outputD : TestEnvironment::_outputND;
     ASSERT_EQ(TestEnvironment::_oss.str(), calibratedOutput);
     server->stop();
   }
 
+  std::string processBatch(POLICYENUM policy, std::string_view batch, std::size_t& duplicates) {
+    ServerOptions::_policyEnum = policy;
+    ServerPtr server = std::make_shared<Server>();
+    EXPECT_TRUE(server->start());
+    std::string output;
+    {
+      Task task(server);
+      HEADER header{ HEADERTYPE::SESSION, batch.size(), 0, COMPRESSORS::NONE,
+		     DIAGNOSTICS::NONE, STATUS::NONE, 0, 0 };
+      task.update(header, batch);
+      while (task.processNext(0));
+      task.getResponse().assemble(output);
+      duplicates = task.getNumberDuplicates();
+    }
+    server->stop();
+    return output;
+  }
+
   void TearDown() {
     TestEnvironment::reset();
   }
 };
 
+// requests without an id or a size are not grouped with
+// requests having the same keywords
+
+TEST_F(LogicTestSortInput, GroupsWithoutId) {
+  std::string_view batch =
+    "[1]size=450x50&kw=disk+cb750\n"
+    "size=450x50&kw=disk+cb750\n"
+    "[2]size=450x50&kw=disk+cb750\n"
+    "[3]kw=disk+cb750\n"
+    "[4]size=450x50&kw=disk+cb750\n";
+  std::size_t duplicates = 0;
+  std::string expected = processBatch(POLICYENUM::NOSORTINPUT, batch, duplicates);
+  ASSERT_EQ(duplicates, 0);
+  for (POLICYENUM policy : { POLICYENUM::SORTINPUT, POLICYENUM::BATCHJOIN }) {
+    ASSERT_EQ(processBatch(policy, batch, duplicates), expected);
+    ASSERT_EQ(duplicates, 2);
+  }
+}
+
 TEST_F(LogicTestSortInput, Sort) {
-  testLogicSortInput(true);
+  testLogicSortInput(POLICYENUM::SORTINPUT);
 }
 
 TEST_F(LogicTestSortInput, NoSort) {
-  testLogicSortInput(false);
+  testLogicSortInput(POLICYENUM::NOSORTINPUT);
+}
+
+TEST_F(LogicTestSortInput, BatchJoin) {
+  testLogicSortInput(POLICYENUM::BATCHJOIN, DIAGNOSTICS::NONE);
+}
+
+TEST_F(LogicTestSortInput, BatchJoinDiagnostics) {
+  testLogicSortInput(POLICYENUM::BATCHJOIN);
 }
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include "IOUtility.h"
+#include "Money.h"
+
+// ./testbin --gtest_filter=MoneyTest*
+
+static_assert(money::parse("12") == 1200);
+static_assert(money::parse("12.3") == 1230);
+static_assert(money::parse("0.05") == 5);
+static_assert(money::parse(".5") == 50);
+static_assert(money::parse("1.005") == 101);
+static_assert(money::parse("1.0049") == 100);
+static_assert(money::parse("-2.5") == -250);
+
+TEST(MoneyTest, Parse) {
+  EXPECT_EQ(money::parse("4.8\""), 480);
+  EXPECT_THROW(money::parse(""), std::runtime_error);
+  EXPECT_THROW(money::parse("abc"), std::runtime_error);
+  EXPECT_THROW(money::parse("."), std::runtime_error);
+  EXPECT_THROW(money::parse("99999999999999999999"), std::runtime_error);
+}
+
+// same output as the floating point formatting it replaced
+// for amounts with one decimal, the ads file format, see
+// TwoDecimals for the others
+TEST(MoneyTest, SameAsDouble) {
+  for (std::int64_t tenths = 0; tenths < 200000; ++tenths) {
+    std::string text;
+    using ioutility::operator<<;
+    text << static_cast<double>(tenths) / 10.;
+    std::int64_t cents = money::parse(text);
+    ASSERT_EQ(cents, std::lround(static_cast<double>(tenths) / 10. * 100.));
+    std::string printed;
+    money::print(cents, printed);
+    ASSERT_EQ(printed, text);
+  }
+}
+
+TEST(MoneyTest, Print) {
+  for (auto [cents, expected] : { std::pair<std::int64_t, std::string_view>{ 0, "0.0" },
+				 { 4, "0.0" }, { 5, "0.1" }, { 1234, "12.3" },
+				 { 1235, "12.4" }, { -1235, "-12.4" } }) {
+    std::string printed;
+    money::print(cents, printed);
+    EXPECT_EQ(printed, expected);
+  }
+}
+
+// ties are rounded away from zero, not to the binary value
+TEST(MoneyTest, TwoDecimals) {
+  for (auto [text, expected] : { std::pair<std::string_view, std::string_view>{ "12.35", "12.4" },
+				 { "12.34", "12.3" }, { "0.25", "0.3" }, { "0.75", "0.8" },
+				 { "0.05", "0.1" }, { "0.04", "0.0" }, { "9.95", "10.0" },
+				 { "-0.25", "-0.3" } }) {
+    std::string printed;
+    money::print(money::parse(text), printed);
+    EXPECT_EQ(printed, expected) << text;
+  }
+}
@@ -0,0 +1,142 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include "Logger.h"
+#include "RequestScanner.h"
+#include "Utility.h"
+
+// ./testbin --gtest_filter=RequestScannerTest*
+
+namespace {
+
+// the previous implementation with string_view::find
+RequestFields findFields(std::string_view request) {
+  RequestFields fields;
+  auto sizePos = request.find("size=");
+  if (sizePos == std::string_view::npos)
+    sizePos = request.find("ad_width=");
+  if (sizePos != std::string_view::npos)
+    fields._size = request.substr(sizePos);
+  for (std::string_view start : { "kw=", "keywords=" }) {
+    auto beg = request.find(start);
+    if (beg == std::string_view::npos)
+      continue;
+    auto end = request.find('&', beg);
+    beg += start.size();
+    fields._keywords = request.substr(beg, end == std::string_view::npos ? end : end - beg);
+    break;
+  }
+  return fields;
+}
+
+constexpr REQUESTFORMAT FORMATS[] = { REQUESTFORMAT::SIZE_KW, REQUESTFORMAT::SIZE_KEYWORDS,
+				      REQUESTFORMAT::WIDTH_KW, REQUESTFORMAT::WIDTH_KEYWORDS,
+				      REQUESTFORMAT::ANY };
+
+void compareFormats(std::string_view request, SCANNER scanner) {
+  RequestFields expected = RequestScanner::scan(request, scanner);
+  for (REQUESTFORMAT format : FORMATS) {
+    RequestFields fields = RequestScanner::scan(request, scanner, format);
+    ASSERT_EQ(fields._size.data(), expected._size.data()) << request;
+    ASSERT_EQ(fields._size, expected._size) << request;
+    ASSERT_EQ(fields._keywords.data(), expected._keywords.data()) << request;
+    ASSERT_EQ(fields._keywords, expected._keywords) << request;
+    ASSERT_EQ(fields._format, expected._format) << request;
+  }
+}
+
+void compare(std::string_view fileName) {
+  std::string input;
+  utility::readFile(fileName, input);
+  std::vector<std::string_view> lines;
+  utility::split(input, lines);
+  ASSERT_FALSE(lines.empty());
+  for (SCANNER scanner : { SCANNER::SCALAR, SCANNER::SSE2, SCANNER::AVX2 }) {
+    if (!RequestScanner::isSupported(scanner))
+      continue;
+    for (std::string_view line : lines) {
+      RequestFields expected = findFields(line);
+      RequestFields fields = RequestScanner::scan(line, scanner);
+      ASSERT_EQ(fields._size.data(), expected._size.data()) << line;
+      ASSERT_EQ(fields._size, expected._size) << line;
+      ASSERT_EQ(fields._keywords.data(), expected._keywords.data()) << line;
+      ASSERT_EQ(fields._keywords, expected._keywords) << line;
+      compareFormats(line, scanner);
+    }
+  }
+}
+
+template <typename FUNC>
+double measure(const std::vector<std::string_view>& lines, FUNC func) {
+  static constexpr int REPETITIONS = 100;
+  std::size_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < REPETITIONS; ++i)
+    for (std::string_view line : lines) {
+      RequestFields fields = func(line);
+      checksum += fields._size.size() + fields._keywords.size();
+    }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_NE(checksum, 0);
+  return elapsed.count();
+}
+
+} // end of anonymous namespace
+
+TEST(RequestScannerTest, Equivalence) {
+  compare("data/requests.log");
+  compare("data/requestsDiffFormat.log");
+}
+
+TEST(RequestScannerTest, Edge) {
+  for (SCANNER scanner : { SCANNER::SCALAR, SCANNER::SSE2, SCANNER::AVX2 }) {
+    if (!RequestScanner::isSupported(scanner))
+      continue;
+    for (std::string_view request : { "", "=", "&", "kw=", "size=1x2", "kw=a+b", "keywords=c&kw=d&size=3x4",
+				       "xad_width=1&ad_height=2&keywords=e+f", "fontsize=5x6&kw=&",
+				       "ad_width=1&keywords=g&size=2x3&kw=h", "keywords=i&ad_width=1&kw=j" }) {
+      RequestFields expected = findFields(request);
+      RequestFields fields = RequestScanner::scan(request, scanner);
+      ASSERT_EQ(fields._size, expected._size) << request;
+      ASSERT_EQ(fields._keywords, expected._keywords) << request;
+      compareFormats(request, scanner);
+    }
+  }
+}
+
+TEST(RequestScannerTest, Format) {
+  ASSERT_EQ(RequestScanner::scan("a=1&size=1x2&kw=a")._format, REQUESTFORMAT::SIZE_KW);
+  ASSERT_EQ(RequestScanner::scan("keywords=a&size=1x2")._format, REQUESTFORMAT::SIZE_KEYWORDS);
+  ASSERT_EQ(RequestScanner::scan("ad_width=1&ad_height=2&kw=")._format, REQUESTFORMAT::WIDTH_KW);
+  ASSERT_EQ(RequestScanner::scan("ad_width=1&ad_height=2&keywords=a")._format, REQUESTFORMAT::WIDTH_KEYWORDS);
+  ASSERT_EQ(RequestScanner::scan("ad_width=1&keywords=a&size=1x2&kw=b")._format, REQUESTFORMAT::SIZE_KW);
+  ASSERT_EQ(RequestScanner::scan("size=1x2")._format, REQUESTFORMAT::ANY);
+  ASSERT_EQ(RequestScanner::scan("kw=a")._format, REQUESTFORMAT::ANY);
+}
+
+// Benchmark, the result is printed. Not run by make, run with
+// ./testbin --gtest_also_run_disabled_tests --gtest_filter=RequestScannerTest.DISABLED_Benchmark
+
+TEST(RequestScannerTest, DISABLED_Benchmark) {
+  std::string input;
+  utility::readFile("data/requests.log", input);
+  std::vector<std::string_view> lines;
+  utility::split(input, lines);
+  double findTime = measure(lines, findFields);
+  LogAlways << "find:" << findTime << "s\n";
+  for (SCANNER scanner : { SCANNER::SCALAR, SCANNER::SSE2, SCANNER::AVX2 }) {
+    if (!RequestScanner::isSupported(scanner))
+      continue;
+    double time = measure(lines, [scanner] (std::string_view line) {
+      return RequestScanner::scan(line, scanner); });
+    LogAlways << "scanner " << static_cast<int>(scanner) << ':' << time << "s\n";
+    time = measure(lines, [scanner] (std::string_view line) {
+      return RequestScanner::scan(line, scanner, REQUESTFORMAT::SIZE_KW); });
+    LogAlways << "scanner " << static_cast<int>(scanner) << " batch format:" << time << "s\n";
+  }
+}
@@ -0,0 +1,57 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include <gtest/gtest.h>
+
+#include "Response.h"
+
+// ./testbin --gtest_filter=ResponseTest*
+
+TEST(ResponseTest, OneArena) {
+  Response response;
+  response.reset(2, 3);
+  response.store(1, 0, "a\n");
+  response.store(1, 1, "bb\n");
+  response.store(1, 2, "ccc\n");
+  std::string output("previous");
+  response.assemble(output);
+  EXPECT_EQ(output, "a\nbb\nccc\n");
+  // the arena swapped with output is reused
+  response.reset(2, 1);
+  response.store(1, 0, "d\n");
+  response.assemble(output);
+  EXPECT_EQ(output, "d\n");
+}
+
+TEST(ResponseTest, Interleaved) {
+  Response response;
+  response.reset(2, 4);
+  response.store(0, 2, "c\n");
+  response.store(1, 1, "b\n");
+  response.store(0, 0, "a\n");
+  // copy of a reply in the same arena
+  response.store(1, 3, response[1]);
+  EXPECT_EQ(response[3], "b\n");
+  std::string output;
+  response.assemble(output);
+  EXPECT_EQ(output, "a\nb\nc\nb\n");
+}
+
+TEST(ResponseTest, Frames) {
+  Response response;
+  response.reset(1, 4);
+  response.store(0, 0, "aaaa\n");
+  response.store(0, 1, "bb\n");
+  response.store(0, 2, "cccccccc\n");
+  response.store(0, 3, "d\n");
+  std::string frame;
+  std::size_t next = response.assemble(frame, 0, 8);
+  EXPECT_EQ(frame, "aaaa\nbb\n");
+  // a reply larger than the frame is not split
+  next = response.assemble(frame, next, 8);
+  EXPECT_EQ(frame, "cccccccc\n");
+  next = response.assemble(frame, next, 8);
+  EXPECT_EQ(frame, "d\n");
+  EXPECT_EQ(next, response.size());
+}
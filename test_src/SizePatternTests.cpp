@@ -0,0 +1,67 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include <boost/regex.hpp>
+#include <gtest/gtest.h>
+
+#include "Logger.h"
+#include "SizePattern.h"
+#include "Utility.h"
+
+// ./testbin --gtest_filter=SizePatternTest*
+
+namespace {
+
+constexpr SizePattern SIZE_PATTERN_REG("size=\\d+x\\d+");
+constexpr SizePattern SIZE_PATTERN_ALT("ad_width=\\d+&ad_height=\\d+");
+
+static_assert([] {
+  SIZETUPLE sizeKey;
+  return SIZE_PATTERN_REG.search("kw=a&size=300x250&x=1", sizeKey) && sizeKey == SIZETUPLE{ 300, 250 };
+}());
+
+SIZETUPLE searchRegex(const std::string& request) {
+  static const boost::regex regexReg("size=(\\d+)x(\\d+)");
+  static const boost::regex regexAlt("ad_width=(\\d+)&ad_height=(\\d+)");
+  for (const boost::regex* regex : { &regexReg, &regexAlt })
+    if (boost::smatch match; boost::regex_search(request, match, *regex))
+      return { std::stoul(match[1]), std::stoul(match[2]) };
+  return {};
+}
+
+} // end of anonymous namespace
+
+TEST(SizePatternTest, SameAsRegex) {
+  for (std::string_view fileName : { "data/requests.log", "data/requestsDiffFormat.log" }) {
+    std::string input;
+    utility::readFile(fileName, input);
+    std::vector<std::string_view> lines;
+    utility::split(input, lines);
+    for (std::string_view line : lines) {
+      SIZETUPLE sizeKey;
+      if (!SIZE_PATTERN_REG.search(line, sizeKey) && !SIZE_PATTERN_ALT.search(line, sizeKey))
+	sizeKey = {};
+      ASSERT_EQ(sizeKey, searchRegex(std::string(line))) << line;
+    }
+  }
+}
+
+TEST(SizePatternTest, Syntax) {
+  SIZETUPLE sizeKey;
+  ASSERT_TRUE(SizePattern("w\\=\\d+\\.\\d+;").search("a=1&w=2.3;", sizeKey));
+  ASSERT_EQ(sizeKey, SIZETUPLE(2, 3));
+  ASSERT_FALSE(SizePattern("size=\\d+x\\d+").search("size=x250&size=300x", sizeKey));
+  ASSERT_TRUE(SizePattern("size=\\d+x\\d+").search("size=1x&size=300x250", sizeKey));
+  ASSERT_EQ(sizeKey, SIZETUPLE(300, 250));
+  ASSERT_THROW(SizePattern("size=\\d+"), std::invalid_argument);
+  ASSERT_THROW(SizePattern("size=\\d+x\\d+x\\d+"), std::invalid_argument);
+  ASSERT_THROW(SizePattern("size=(\\d+)x\\d+"), std::invalid_argument);
+  ASSERT_THROW(SizePattern("size=\\d+1\\d+"), std::invalid_argument);
+  ASSERT_THROW(SizePattern("size=\\d+x\\d+\\"), std::invalid_argument);
+  ASSERT_THROW(SizePattern("size=\\d+\\wx\\d+"), std::invalid_argument);
+  ASSERT_THROW(SizePattern("size=\\d+x\\d+\\s"), std::invalid_argument);
+  ASSERT_THROW(SizePattern("\\d\\d+x\\d+"), std::invalid_argument);
+  ASSERT_THROW(SizePattern("size=\\d+\\1\\d+"), std::invalid_argument);
+  ASSERT_THROW(SizePattern("size=\\d+x\\d+").search("size=99999999999x1", sizeKey), std::runtime_error);
+}
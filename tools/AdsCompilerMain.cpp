@@ -0,0 +1,27 @@
+/*
+ *  Copyright (C) 2021 Ilya Entin
+ */
+
+#include <iostream>
+
+#include "AdCatalog.h"
+
+// Compiles the ads text file into the binary catalog image
+// which the server maps read-only instead of parsing the text.
+// adsCompilerX [textFile [imageFile]]
+
+int main(int argc, char* argv[]) {
+  std::string_view textFile = argc > 1 ? argv[1] : "data/ads.txt";
+  std::string_view imageFile = argc > 2 ? argv[2] : "data/ads.bin";
+  try {
+    AdCatalog::compile(textFile, imageFile);
+    AdCatalog catalog(imageFile);
+    std::cout << "compiled " << catalog.size() << " ads "
+	      << catalog.getDictionary().size() << " keywords to " << imageFile << '\n';
+    return 0;
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
+}